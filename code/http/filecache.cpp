@@ -0,0 +1,577 @@
+#include "filecache.h"
+#include "httpresponse.h"
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <zlib.h>
+
+using namespace std;
+
+// 支持的文件后缀类型
+const unordered_map<string, string> FileCache::SUFFIX_TYPE = {
+    { ".html",  "text/html" },
+    { ".xml",   "text/xml" },
+    { ".xhtml", "application/xhtml+xml" },
+    { ".txt",   "text/plain" },
+    { ".rtf",   "application/rtf" },
+    { ".pdf",   "application/pdf" },
+    { ".word",  "application/nsword" },
+    { ".png",   "image/png" },
+    { ".gif",   "image/gif" },
+    { ".jpg",   "image/jpeg" },
+    { ".jpeg",  "image/jpeg" },
+    { ".au",    "audio/basic" },
+    { ".mpeg",  "video/mpeg" },
+    { ".mpg",   "video/mpeg" },
+    { ".avi",   "video/x-msvideo" },
+    { ".gz",    "application/x-gzip" },
+    { ".tar",   "application/x-tar" },
+    { ".css",   "text/css" },
+    { ".js",    "text/javascript" },
+    { ".json",  "application/json" },
+    { ".svg",   "image/svg+xml" },
+    { ".ttf",   "font/ttf" },
+    { ".otf",   "font/otf" },
+    { ".eot",   "application/vnd.ms-fontobject" },
+    { ".woff",  "font/woff" },
+    { ".woff2", "font/woff2" },
+};
+
+// 路径前缀（相对资源目录）对应的缓存策略：样式、脚本、字体、图片很少改动，允许浏览器直接使用缓存；
+// 其余文件（网页）每次都向服务器验证，未修改时返回304
+const vector<pair<string, string>> FileCache::PATH_CACHE_CONTROL = {
+    { "/css/",    "public, max-age=86400" },
+    { "/js/",     "public, max-age=86400" },
+    { "/fonts/",  "public, max-age=2592000" },
+    { "/images/", "public, max-age=604800" },
+    { "/video/",  "public, max-age=604800" },
+};
+
+// 监视的事件：文件内容、属性变化，文件被删除或被改名替换
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE
+                                 | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF
+                                 | IN_CREATE;  // 新建的预压缩文件使“没有编码版本”的缓存项失效
+
+// 最后一个引用释放时才解除映射、关闭文件
+FileEntry::~FileEntry() {
+    if(mapped) { munmap(data, size); }
+    if(fd >= 0) { close(fd); }
+}
+
+FileCache::FileCache() : maxBytes_(0), curBytes_(0), mapFiles_(true), seq_(0),
+                         inotifyFd_(-1), wakeFd_(-1), closing_(false) {}
+
+FileCache::~FileCache() {
+    Close();
+}
+
+// 单例模式：定义一个实例
+FileCache* FileCache::Instance() {
+    static FileCache cache;
+    return &cache;
+}
+
+// 初始化：inotify不可用时无法感知文件变化，不做缓存
+void FileCache::Init(const string& root, size_t maxBytes, bool mapFiles) {
+    Close();
+    root_ = NormalizePath_(root + "/");
+    mapFiles_ = mapFiles;
+    maxBytes_ = maxBytes;
+    if(maxBytes_ == 0) { return; }
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(inotifyFd_ < 0 || wakeFd_ < 0) {
+        LOG_WARN("inotify unavailable, file cache disabled!");
+        Close();
+        return;
+    }
+    watchThread_.reset(new thread(&FileCache::WatchLoop_, this));
+    closing_ = false;
+    compressThread_.reset(new thread(&FileCache::CompressLoop_, this));
+}
+
+// 停止inotify线程和压缩线程，清空缓存：仍被连接引用的缓存项在引用释放时关闭
+void FileCache::Close() {
+    if(compressThread_) {
+        {
+            lock_guard<mutex> locker(mtx_);
+            closing_ = true;
+        }
+        compressCond_.notify_one();
+        compressThread_->join();
+        compressThread_.reset();
+    }
+    if(watchThread_) {
+        uint64_t one = 1;
+        ssize_t ret = write(wakeFd_, &one, sizeof(one));
+        (void)ret;
+        watchThread_->join();
+        watchThread_.reset();
+    }
+    if(inotifyFd_ >= 0) { close(inotifyFd_); inotifyFd_ = -1; }
+    if(wakeFd_ >= 0) { close(wakeFd_); wakeFd_ = -1; }
+    lock_guard<mutex> locker(mtx_);
+    entries_.clear();
+    lru_.clear();
+    missingLru_.clear();
+    dirs_.clear();
+    watched_.clear();
+    compressQueue_.clear();
+    compressing_.clear();
+    curBytes_ = 0;
+    maxBytes_ = 0;
+}
+
+// 缓存的总字节数
+size_t FileCache::Size() {
+    lock_guard<mutex> locker(mtx_);
+    return curBytes_;
+}
+
+// 获取文件：命中时不访问文件系统；未命中时先监视所在目录再加载，
+// 加载期间目录中有文件变化则结果只用于本次请求，不放入缓存
+FileEntryPtr FileCache::Get(const string& path, int* saveErrno) {
+    string key = NormalizePath_(path);
+    if(!InRoot_(key)) {
+        *saveErrno = ENOENT;
+        return nullptr;
+    }
+    uint64_t seq = 0;
+    bool cacheable = false;
+    {
+        lock_guard<mutex> locker(mtx_);
+        auto it = entries_.find(key);
+        if(it != entries_.end()) {
+            Node& node = it->second;
+            if(node.missing) {
+                missingLru_.splice(missingLru_.begin(), missingLru_, node.pos);
+                *saveErrno = node.err;
+            } else {
+                lru_.splice(lru_.begin(), lru_, node.pos);
+            }
+            return node.entry;
+        }
+        seq = seq_;
+        cacheable = maxBytes_ > 0 && Watch_(key);
+    }
+    shared_ptr<FileEntry> entry = Load_(key, saveErrno);
+    if(entry) {
+        entry->compressible = IsCompressible_(entry->type);
+        MakeHeaders_(entry.get(), key);
+    }
+    if(!cacheable) { return entry; }
+    // 单个文件超过预算的1/4时不缓存，避免一个大文件挤掉所有小文件
+    if(entry && entry->size <= maxBytes_ / 4) {
+        lock_guard<mutex> locker(mtx_);
+        if(seq == seq_) { Insert_(key, entry); }
+    }
+    // 文件不存在或不可读时缓存失败原因；文件描述符耗尽等临时错误不缓存
+    else if(!entry && (*saveErrno == ENOENT || *saveErrno == ENOTDIR || *saveErrno == EACCES)) {
+        lock_guard<mutex> locker(mtx_);
+        if(seq == seq_) { InsertMissing_(key, *saveErrno); }
+    }
+    return entry;
+}
+
+// 获取文件的编码版本：缓存键为路径加'\n'加编码名，请求路径中不会出现控制字符
+// identity可能是失效前取得的旧版本，只有它仍是缓存中的版本时，由它得到的编码版本才放入缓存
+FileEntryPtr FileCache::GetEncoded(const string& path, const string& encoding, const FileEntryPtr& identity) {
+    string key = NormalizePath_(path);
+    if(!InRoot_(key)) { return nullptr; }
+    string variantKey = key + '\n' + encoding;
+    uint64_t seq = 0;
+    bool cacheable = false;
+    {
+        lock_guard<mutex> locker(mtx_);
+        auto it = entries_.find(variantKey);
+        if(it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.pos);
+            return it->second.entry;
+        }
+        seq = seq_;
+        cacheable = maxBytes_ > 0 && Watch_(key);
+    }
+    FileEntryPtr entry = LoadEncoded_(key, encoding, identity);
+    // 没有预压缩文件：交给压缩线程，本次发送未编码的版本，压缩完成后的请求命中缓存；不缓存时不即时压缩
+    if(!entry && encoding == "gzip" && CanCompress_(*identity)) {
+        if(cacheable) { QueueCompress_(key, identity, seq); }
+        return nullptr;
+    }
+    if(cacheable && (!entry || entry->size <= maxBytes_ / 4)) {
+        lock_guard<mutex> locker(mtx_);
+        if(seq == seq_ && IsCurrent_(key, identity)) { Insert_(variantKey, entry); }
+    }
+    return entry;
+}
+
+// 加载预压缩文件：比原文件旧时视为过期不用
+FileEntryPtr FileCache::LoadEncoded_(const string& path, const string& encoding, const FileEntryPtr& identity) {
+    int err = 0;
+    shared_ptr<FileEntry> entry = Load_(path + (encoding == "br" ? ".br" : ".gz"), &err);
+    if(!entry || entry->mtime < identity->mtime) {
+        return nullptr;
+    }
+    entry->type = identity->type;
+    entry->compressible = true;
+    entry->encoding = encoding;
+    MakeHeaders_(entry.get(), path);
+    return entry;
+}
+
+// 即时gzip压缩：压缩后不比原文件小时不用
+FileEntryPtr FileCache::Compress_(const string& path, const FileEntryPtr& identity) {
+    shared_ptr<FileEntry> entry = make_shared<FileEntry>();
+    bool ok = false;
+    if(identity->data) {
+        ok = Deflate_(identity->data, identity->size, &entry->compressed);
+    } else if(identity->fd >= 0) {
+        // sendfile模式下没有映射，先读入内存
+        string content(identity->size, '\0');
+        ok = pread(identity->fd, &content[0], content.size(), 0) == static_cast<ssize_t>(content.size())
+            && Deflate_(content.data(), content.size(), &entry->compressed);
+    }
+    if(!ok || entry->compressed.size() >= identity->size) {
+        return nullptr;
+    }
+    entry->data = &entry->compressed[0];
+    entry->size = entry->compressed.size();
+    entry->mtime = identity->mtime;
+    // 同一文件不同编码的内容不同，强ETag也要不同
+    entry->etag = identity->etag.substr(0, identity->etag.size() - 1) + "-gzip\"";
+    entry->type = identity->type;
+    entry->compressible = true;
+    entry->encoding = "gzip";
+    MakeHeaders_(entry.get(), path);
+    return entry;
+}
+
+// 文件加入压缩队列：已在排队或正在压缩时不重复加入，队列满时放弃，之后的请求再尝试
+void FileCache::QueueCompress_(const string& path, const FileEntryPtr& identity, uint64_t seq) {
+    {
+        lock_guard<mutex> locker(mtx_);
+        if(!compressThread_ || compressQueue_.size() >= MAX_COMPRESS_QUEUE || !compressing_.insert(path).second) {
+            return;
+        }
+        compressQueue_.push_back({ path, identity, seq });
+    }
+    compressCond_.notify_one();
+}
+
+// 压缩线程：压缩期间文件有变化（失效序号改变或缓存中已是新版本）时丢弃结果
+void FileCache::CompressLoop_() {
+    unique_lock<mutex> locker(mtx_);
+    while(true) {
+        compressCond_.wait(locker, [this] { return closing_ || !compressQueue_.empty(); });
+        if(closing_) { break; }
+        CompressTask task = move(compressQueue_.front());
+        compressQueue_.pop_front();
+        locker.unlock();
+        FileEntryPtr entry = Compress_(task.path, task.identity);
+        locker.lock();
+        compressing_.erase(task.path);
+        if(maxBytes_ > 0 && task.seq == seq_ && IsCurrent_(task.path, task.identity)
+            && (!entry || entry->size <= maxBytes_ / 4)) {
+            Insert_(task.path + "\ngzip", entry);
+        }
+    }
+}
+
+// identity是否仍是该文件缓存中的版本：文件变化后缓存项被删除或替换，未缓存的文件也视为不是
+bool FileCache::IsCurrent_(const string& path, const FileEntryPtr& identity) const {
+    auto it = entries_.find(path);
+    return it != entries_.end() && !it->second.missing && it->second.entry == identity;
+}
+
+// 长度是否在即时压缩的范围内：太小的文件压缩后没有收益，太大的文件压缩耗时过长
+bool FileCache::CanCompress_(const FileEntry& identity) {
+    return identity.size >= MIN_COMPRESS && identity.size <= MAX_COMPRESS;
+}
+
+// gzip压缩：每个线程复用一个z_stream，只在线程第一次压缩时分配内部状态
+bool FileCache::Deflate_(const char* data, size_t len, string* out) {
+    struct Deflater {
+        z_stream zs;
+        bool ok;
+        Deflater() {
+            memset(&zs, 0, sizeof(zs));
+            // windowBits为15+16时输出gzip格式
+            ok = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        }
+        ~Deflater() { if(ok) { deflateEnd(&zs); } }
+    };
+    static thread_local Deflater deflater;
+    if(!deflater.ok || deflateReset(&deflater.zs) != Z_OK) { return false; }
+    out->resize(deflateBound(&deflater.zs, len));
+    deflater.zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    deflater.zs.avail_in = len;
+    deflater.zs.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+    deflater.zs.avail_out = out->size();
+    if(deflate(&deflater.zs, Z_FINISH) != Z_STREAM_END) { return false; }
+    out->resize(deflater.zs.total_out);
+    out->shrink_to_fit();
+    return true;
+}
+
+// 打开文件：目录视为不存在，其他用户不可读的文件拒绝访问
+shared_ptr<FileEntry> FileCache::Load_(const string& path, int* saveErrno) {
+    int fd = open(path.data(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        *saveErrno = errno;
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0) {
+        *saveErrno = errno;
+        close(fd);
+        return nullptr;
+    }
+    if(S_ISDIR(st.st_mode) || !(st.st_mode & S_IROTH)) {
+        *saveErrno = S_ISDIR(st.st_mode) ? ENOENT : EACCES;
+        close(fd);
+        return nullptr;
+    }
+    shared_ptr<FileEntry> entry = make_shared<FileEntry>();
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtime;
+    entry->type = GetFileType_(path);
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx-%llx\"", static_cast<unsigned long>(st.st_ino),
+             static_cast<unsigned long>(st.st_size),
+             static_cast<unsigned long long>(st.st_mtim.tv_sec) * 1000000000ull + st.st_mtim.tv_nsec);
+    entry->etag = etag;
+    if(!mapFiles_) {
+        entry->fd = fd;  // sendfile模式：保留文件描述符
+        return entry;
+    }
+    if(entry->size > 0) {
+        // 将文件映射到内存以提高文件的访问速度 MAP_PRIVATE 建立一个写入时拷贝的私有映射
+        void* mmRet = mmap(0, entry->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mmRet == MAP_FAILED) {
+            *saveErrno = errno;
+            close(fd);
+            return nullptr;
+        }
+        entry->data = static_cast<char*>(mmRet);
+        entry->mapped = true;
+    }
+    close(fd);
+    return entry;
+}
+
+// 加入缓存，超出预算时从最久未使用的一端淘汰
+void FileCache::Insert_(const string& path, const FileEntryPtr& entry) {
+    Erase_(path);
+    lru_.push_front(path);
+    entries_[path] = { entry, 0, false, lru_.begin() };
+    curBytes_ += entry ? entry->size : 0;
+    while(curBytes_ > maxBytes_ && !lru_.empty()) {
+        Erase_(lru_.back());
+    }
+}
+
+// 缓存查找失败的结果：超过数量上限时从最久未使用的一端淘汰
+void FileCache::InsertMissing_(const string& path, int err) {
+    Erase_(path);
+    missingLru_.push_front(path);
+    entries_[path] = { nullptr, err, true, missingLru_.begin() };
+    while(missingLru_.size() > MAX_MISSING) {
+        Erase_(missingLru_.back());
+    }
+}
+
+// 删除一个缓存项：正在发送的连接仍持有引用
+void FileCache::Erase_(const string& path) {
+    auto it = entries_.find(path);
+    if(it == entries_.end()) { return; }
+    curBytes_ -= it->second.entry ? it->second.entry->size : 0;
+    (it->second.missing ? missingLru_ : lru_).erase(it->second.pos);
+    entries_.erase(it);
+}
+
+// 删除路径以prefix开头的缓存项：目录被删除、改名或新建时使用，遍历全部缓存项
+void FileCache::ErasePrefix_(const string& prefix) {
+    for(list<string>* lru: { &lru_, &missingLru_ }) {
+        for(auto entry = lru->begin(); entry != lru->end(); ) {
+            string path = *entry++;
+            if(path.compare(0, prefix.size(), prefix) == 0) { Erase_(path); }
+        }
+    }
+}
+
+// 文件变化：删除该文件与它的编码版本；预压缩文件变化时删除对应文件的该编码版本
+void FileCache::EraseFile_(const string& path) {
+    Erase_(path);
+    Erase_(path + "\ngzip");
+    Erase_(path + "\nbr");
+    size_t len = path.size();
+    if(len > 3 && path.compare(len - 3, 3, ".gz") == 0) {
+        Erase_(path.substr(0, len - 3) + "\ngzip");
+    } else if(len > 3 && path.compare(len - 3, 3, ".br") == 0) {
+        Erase_(path.substr(0, len - 3) + "\nbr");
+    }
+}
+
+// 监视文件所在目录：监视目录而不是文件本身，文件被改名替换后仍能收到事件
+// 路径已规范化并在资源目录内；目录不存在时监视最近的存在的上级目录（不越过资源目录），中间目录被创建时由上级目录的事件使缓存项失效
+bool FileCache::Watch_(const string& path) {
+    string dir = path;
+    while(true) {
+        size_t slash = dir.find_last_of('/');
+        if(slash == string::npos) { return false; }
+        dir.resize(slash);
+        if(dir.size() + 1 < root_.size()) { return false; }
+        if(watched_.count(dir)) { return true; }
+        int wd = inotify_add_watch(inotifyFd_, dir.empty() ? "/" : dir.data(), WATCH_MASK);
+        if(wd >= 0) {
+            watched_[dir] = wd;
+            dirs_[wd].push_back(dir);  // 经符号链接的不同路径可能得到同一个监视描述符
+            return true;
+        }
+        if(errno != ENOENT && errno != ENOTDIR) {
+            LOG_WARN("inotify watch %s error: %d", dir.data(), errno);
+            return false;
+        }
+    }
+}
+
+// inotify线程：文件变化时删除对应缓存项，目录本身被删除或改名时删除该目录下的全部缓存项
+void FileCache::WatchLoop_() {
+    alignas(struct inotify_event) char buf[4096];
+    struct pollfd fds[2] = { { inotifyFd_, POLLIN, 0 }, { wakeFd_, POLLIN, 0 } };
+    while(true) {
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) { continue; }
+            break;
+        }
+        if(fds[1].revents) { break; }
+        CoarseClock::Update();  // 本线程不在事件循环中，自行更新时钟
+        ssize_t len = read(inotifyFd_, buf, sizeof(buf));
+        if(len <= 0) { continue; }
+        lock_guard<mutex> locker(mtx_);
+        seq_++;
+        for(char* p = buf; p < buf + len; ) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+            if(event->mask & IN_Q_OVERFLOW) {
+                // 事件丢失：无法判断哪些文件变了，全部清空
+                entries_.clear();
+                lru_.clear();
+                missingLru_.clear();
+                curBytes_ = 0;
+                continue;
+            }
+            auto it = dirs_.find(event->wd);
+            if(it == dirs_.end()) { continue; }
+            if(event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                for(const string& dir: it->second) {
+                    ErasePrefix_(dir + "/");
+                    watched_.erase(dir);
+                }
+                if(!(event->mask & IN_IGNORED)) { inotify_rm_watch(inotifyFd_, event->wd); }
+                dirs_.erase(it);
+                continue;
+            }
+            if(event->len > 0) {
+                for(const string& dir: it->second) {
+                    LOG_DEBUG("file changed: %s/%s", dir.data(), event->name);
+                    EraseFile_(dir + "/" + event->name);
+                    // 子目录新建、删除或改名：其下的缓存项（包括不存在的路径）全部失效
+                    if(event->mask & IN_ISDIR) { ErasePrefix_(dir + "/" + event->name + "/"); }
+                }
+            }
+        }
+    }
+}
+
+// 生成响应头：文件不变时响应头只有状态行和Date会变化，其余部分加载时生成一次
+void FileCache::MakeHeaders_(FileEntry* entry, const string& path) const {
+    char lastModified[64];
+    struct tm t;
+    gmtime_r(&entry->mtime, &t);
+    strftime(lastModified, sizeof(lastModified), "%a, %d %b %Y %H:%M:%S GMT", &t);
+    // 304响应也要带Vary，缓存据此区分同一路径的不同编码版本
+    string validators = "ETag: " + entry->etag + "\r\n"
+                      + "Last-Modified: " + lastModified + "\r\n"
+                      + "Cache-Control: " + GetCacheControl_(path) + "\r\n"
+                      + (entry->compressible ? "Vary: Accept-Encoding\r\n" : "");
+    entry->entityHeaders = (entry->encoding.empty() ? "" : "Content-Encoding: " + entry->encoding + "\r\n")
+                         + validators;
+    string tail = "Content-type: " + entry->type + "\r\n"
+                + entry->entityHeaders
+                + "Accept-Ranges: bytes\r\n"
+                + "Content-length: " + to_string(entry->size) + "\r\n\r\n";
+    for(int i = 0; i < 2; i++) {
+        const string& conn = HttpResponse::ConnHeader(i);
+        entry->headers[i] = conn + tail;
+        entry->notModified[i] = conn + validators + "\r\n";
+    }
+}
+
+// 规范化后的路径是否在资源目录内：资源目录以外的文件不发送、不缓存、不监视
+bool FileCache::InRoot_(const string& key) const {
+    return !key.empty() && key.compare(0, root_.size(), root_) == 0;
+}
+
+// 由路径前缀得到Cache-Control：资源目录以外的文件与未列出的路径每次验证
+string FileCache::GetCacheControl_(const string& path) const {
+    if(path.compare(0, root_.size(), root_) == 0) {
+        for(const auto& rule: PATH_CACHE_CONTROL) {
+            if(path.compare(root_.size() - 1, rule.first.size(), rule.first) == 0) {
+                return rule.second;
+            }
+        }
+    }
+    return "no-cache";
+}
+
+// 规范化路径：合并连续的'/'，去掉"."段，".."段回退一级，保留结尾的'/'；同一文件只对应一个缓存项和一个监视目录
+// ".."越过路径开头时返回空串
+string FileCache::NormalizePath_(const string& path) {
+    bool absolute = !path.empty() && path[0] == '/';
+    string key;
+    key.reserve(path.size());
+    for(size_t i = 0, end; i < path.size(); i = end + 1) {
+        end = path.find('/', i);
+        if(end == string::npos) { end = path.size(); }
+        size_t len = end - i;
+        if(len == 0 || (len == 1 && path[i] == '.')) { continue; }
+        if(len == 2 && path[i] == '.' && path[i + 1] == '.') {
+            if(key.empty()) { return ""; }
+            size_t slash = key.find_last_of('/');
+            key.resize(slash == string::npos ? 0 : slash);
+            continue;
+        }
+        if(absolute || !key.empty()) { key.push_back('/'); }
+        key.append(path, i, len);
+    }
+    if(absolute && key.empty()) { return "/"; }
+    if(!key.empty() && path.back() == '/') { key.push_back('/'); }
+    return key;
+}
+
+// 可压缩的类型：文本与未压缩的字体；图片、woff字体和压缩包本身已经压缩过
+bool FileCache::IsCompressible_(const string& type) {
+    static const char* TYPES[] = {
+        "application/javascript", "application/json", "application/xml", "application/xhtml+xml",
+        "application/rtf", "image/svg+xml", "font/ttf", "font/otf", "application/vnd.ms-fontobject",
+    };
+    if(type.compare(0, 5, "text/") == 0) { return true; }
+    for(const char* t: TYPES) {
+        if(type == t) { return true; }
+    }
+    return false;
+}
+
+// 获取文件类型
+string FileCache::GetFileType_(const string& path) {
+    // 判断文件类型，然后去对应的文件后缀后面查找
+    string::size_type idx = path.find_last_of('.');
+    if(idx == string::npos || path.find('/', idx) != string::npos) {
+        return "text/plain";
+    }
+    string suffix = path.substr(idx);
+    if(SUFFIX_TYPE.count(suffix) == 1) {
+        return SUFFIX_TYPE.find(suffix)->second;
+    }
+    return "text/plain";
+}
@@ -0,0 +1,138 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <time.h>
+#include <fcntl.h>       // open
+#include <unistd.h>      // close
+#include <sys/stat.h>    // stat
+#include <sys/mman.h>    // mmap, munmap
+
+#include "../log/log.h"
+
+// 缓存的静态文件：打开的文件描述符、只读映射和元数据，创建后不再修改，多个连接共享
+struct FileEntry {
+    FileEntry() : fd(-1), data(nullptr), mapped(false), size(0), mtime(0), compressible(false) {}
+    ~FileEntry();
+
+    int fd;  // 文件描述符，sendfile发送时使用
+    char* data;  // 文件内容：文件映射或compressed，空文件或不映射时为nullptr
+    bool mapped;  // data是否为文件映射
+    size_t size;  // 文件长度
+    time_t mtime;  // 最后修改时间
+    std::string type;  // Content-type
+    bool compressible;  // 是否为可压缩的类型：按Accept-Encoding协商编码
+    std::string encoding;  // Content-Encoding："gzip"、"br"，未编码为空
+    std::string compressed;  // 即时压缩的结果
+    std::string etag;  // 强ETag：由inode、长度和纳秒级修改时间生成
+    // 预先生成的响应头：[0]不保持连接，[1]保持连接；从Connection到空行，不含状态行和Date
+    std::string headers[2];
+    std::string notModified[2];  // 304响应的响应头：只有连接与缓存验证相关的字段
+    std::string entityHeaders;  // 206响应附带的字段：Content-Encoding与缓存验证相关的字段
+};
+
+typedef std::shared_ptr<const FileEntry> FileEntryPtr;
+
+// 进程级静态文件缓存：按完整路径缓存文件，按LRU淘汰，总长度不超过预算；查找失败（不存在、不可读）的结果也缓存，数量有上限
+// 文件被修改、删除、替换或新建时由inotify线程使对应缓存项失效；连接借用缓存项的引用，
+// 缓存项被淘汰或失效后，仍在发送它的连接发送完释放引用时才关闭文件、解除映射
+class FileCache {
+public:
+    // 单例模式
+    static FileCache* Instance();
+
+    // 初始化：资源目录（用于按路径前缀确定Cache-Control），缓存预算（字节，0表示不缓存），是否把文件映射到内存
+    void Init(const std::string& root, size_t maxBytes, bool mapFiles);
+    // 获取文件：失败返回nullptr，saveErrno为ENOENT（不存在或是目录）、EACCES（其他用户不可读）或其他错误
+    FileEntryPtr Get(const std::string& path, int* saveErrno);
+    // 获取文件的编码版本："br"、"gzip"优先使用同目录下的.br、.gz预压缩文件，gzip没有预压缩文件时交给压缩线程即时压缩，
+    // 压缩完成前返回nullptr（发送未编码的版本）；没有可用的编码版本返回nullptr，结果（包括没有）与普通文件一起缓存
+    FileEntryPtr GetEncoded(const std::string& path, const std::string& encoding, const FileEntryPtr& identity);
+    // 停止inotify线程和压缩线程，清空缓存
+    void Close();
+
+    size_t Size();  // 缓存的总字节数
+
+private:
+    // 单例模式：私有的构造函数和析构函数
+    FileCache();
+    ~FileCache();
+
+    std::shared_ptr<FileEntry> Load_(const std::string& path, int* saveErrno);  // 打开并映射文件
+    FileEntryPtr LoadEncoded_(const std::string& path, const std::string& encoding, const FileEntryPtr& identity);  // 加载预压缩文件
+    FileEntryPtr Compress_(const std::string& path, const FileEntryPtr& identity);  // 即时gzip压缩
+    void QueueCompress_(const std::string& path, const FileEntryPtr& identity, uint64_t seq);  // 文件加入压缩队列
+    void CompressLoop_();  // 压缩线程：依次压缩排队的文件，结果放入缓存
+    bool IsCurrent_(const std::string& path, const FileEntryPtr& identity) const;  // identity是否仍是该文件缓存中的版本
+    void Insert_(const std::string& path, const FileEntryPtr& entry);  // 加入缓存并按预算淘汰
+    void InsertMissing_(const std::string& path, int err);  // 缓存查找失败的结果
+    void Erase_(const std::string& path);  // 删除一个缓存项
+    void EraseFile_(const std::string& path);  // 文件变化：删除该文件及相关编码版本的缓存项
+    void ErasePrefix_(const std::string& prefix);  // 删除路径以prefix开头的缓存项
+    bool Watch_(const std::string& path);  // 监视文件所在目录
+    void WatchLoop_();  // inotify线程：读取事件并使缓存项失效
+
+    static std::string NormalizePath_(const std::string& path);  // 规范化路径：合并'/'，解析"."与".."
+    bool InRoot_(const std::string& key) const;  // 规范化后的路径是否在资源目录内
+    static std::string GetFileType_(const std::string& path);  // 由后缀得到Content-type
+    static bool IsCompressible_(const std::string& type);  // 是否为可压缩的类型
+    static bool CanCompress_(const FileEntry& identity);  // 长度是否在即时压缩的范围内
+    static bool Deflate_(const char* data, size_t len, std::string* out);  // gzip压缩
+    std::string GetCacheControl_(const std::string& path) const;  // 由路径前缀得到Cache-Control
+    void MakeHeaders_(FileEntry* entry, const std::string& path) const;  // 生成响应头
+
+    struct CompressTask {
+        std::string path;
+        FileEntryPtr identity;  // 未编码的版本
+        uint64_t seq;  // 加入队列前的失效序号
+    };
+
+    struct Node {
+        FileEntryPtr entry;
+        int err;  // 查找失败的缓存项：失败原因
+        bool missing;  // 是否为查找失败的缓存项
+        std::list<std::string>::iterator pos;  // 在lru_或missingLru_中的位置
+    };
+
+    std::string root_;  // 资源目录，以'/'结尾
+    size_t maxBytes_;  // 缓存预算
+    size_t curBytes_;  // 缓存的总字节数
+    bool mapFiles_;  // 是否把文件映射到内存
+    uint64_t seq_;  // 失效序号：加载期间有失效事件时，加载结果不放入缓存
+
+    std::unordered_map<std::string, Node> entries_;  // 路径-缓存项
+    std::list<std::string> lru_;  // 最近使用的在前
+    std::list<std::string> missingLru_;  // 查找失败的缓存项，单独淘汰，大量不存在的路径不会挤掉文件
+    std::unordered_map<int, std::vector<std::string>> dirs_;  // inotify监视描述符-目录
+    std::unordered_map<std::string, int> watched_;  // 已监视的目录
+    std::mutex mtx_;
+
+    int inotifyFd_;
+    int wakeFd_;  // 关闭时唤醒inotify线程
+    std::unique_ptr<std::thread> watchThread_;  // inotify线程
+
+    // 即时压缩在单独的线程中进行，不占用事件循环；同一文件只压缩一次，队列满时不再加入
+    std::deque<CompressTask> compressQueue_;
+    std::unordered_set<std::string> compressing_;  // 排队或正在压缩的文件
+    std::condition_variable compressCond_;
+    bool closing_;  // 通知压缩线程退出
+    std::unique_ptr<std::thread> compressThread_;  // 压缩线程
+
+    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;  // 后缀-类型
+    static const std::vector<std::pair<std::string, std::string>> PATH_CACHE_CONTROL;  // 路径前缀-Cache-Control
+    static const size_t MAX_MISSING = 4096;  // 查找失败的缓存项的最大数量
+    static const size_t MIN_COMPRESS = 256;  // 小于该长度的文件不压缩
+    static const size_t MAX_COMPRESS = 4 << 20;  // 大于该长度的文件不即时压缩
+    static const size_t MAX_COMPRESS_QUEUE = 64;  // 等待即时压缩的最大文件数
+};
+
+#endif //FILE_CACHE_H
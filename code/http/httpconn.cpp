@@ -4,11 +4,19 @@ using namespace std;
 const char* HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+bool HttpConn::useCork;
+int HttpConn::headerTimeoutMS;
+int HttpConn::bodyTimeoutMS;
+int HttpConn::idleTimeoutMS;
+size_t HttpConn::minSendRate;
+int HttpConn::maxKeepAliveRequests;
 
-HttpConn::HttpConn() { 
+HttpConn::HttpConn() : gen_(0), pending_(0), deferredRead_(0), chainIdx_(0), toWrite_(0), corked_(false), respCnt_(0) { 
     fd_ = -1;
     addr_ = { 0 };
+    chain_.reserve(2 * MAX_PIPELINE);
     isClose_ = true;
+    timerNode_.owner = this;
 };
 
 HttpConn::~HttpConn() { 
@@ -23,13 +31,39 @@ void HttpConn::init(int fd, const sockaddr_in& addr) {
     fd_ = fd;
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    chain_.clear();
+    chainIdx_ = 0;
+    toWrite_ = 0;
+    corked_ = false;
+    respCnt_ = 0;
+    requestCnt_ = 0;
+    request_.Init();
+    phase_ = HEADER_PHASE;  // 新连接在请求头超时内必须发来完整的请求头
+    phaseSince_ = CoarseClock::NowMs();
+    sent_ = windowSent_ = 0;
+    windowSince_ = phaseSince_;
+    if(HttpResponse::useSendfile) {
+        // 响应头与文件分两次发送：关闭Nagle，否则取消TCP_CORK后最后一个不满的报文段
+        // 要等客户端的延迟确认才发出，每批响应多出约40ms
+        int opt = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    }
     isClose_ = false;
+    gen_.fetch_add(1, std::memory_order_release);  // 进入新的代数（奇数）
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
 }
 
+// 作废当前代数：只有持有当前代数的一方能够成功，成功后旧句柄全部失效
+bool HttpConn::Invalidate(uint32_t gen) {
+    if(!(gen & 1)) { return false; }
+    return gen_.compare_exchange_strong(gen, gen + 1, std::memory_order_acq_rel);
+}
+
 // 关闭连接
 void HttpConn::Close() {
-    response_.UnmapFile();
+    for(int i = 0; i < respCnt_; i++) {
+        response_[i].ReleaseFile();
+    }
     if(isClose_ == false){
         isClose_ = true; 
         userCount--;
@@ -66,66 +100,246 @@ ssize_t HttpConn::read(int* saveErrno) {
         if (len <= 0) {
             break;
         }
-    } while (isET);
+    } while (isET && readBuff_.ReadableBytes() < MAX_READ_BUFF);  // 缓冲区较大时先处理，EPOLLONESHOT重新注册后会再次通知
+    UpdatePhase_();
     return len;
 }
 
-// 集中写，传输响应报文
+// 集中写，传输响应报文：相邻的内存块合并为一次writev，文件区间用sendfile发送
 ssize_t HttpConn::write(int* saveErrno) {
     ssize_t len = -1;
     do {
-        // 集中写
-        len = writev(fd_, iov_, iovCnt_);
+        if(chainIdx_ >= chain_.size()) { break; }
+        Chunk& chunk = chain_[chainIdx_];
+        if(chunk.data) {
+            // 集中写
+            struct iovec iov[MAX_IOV];
+            len = writev(fd_, iov, FillIov_(iov));
+        } else {
+            // 文件内容由内核直接从页缓存发送，不经过用户态
+            off_t offset = chunk.offset;
+            len = sendfile(fd_, chunk.fileFd, &offset, chunk.len);
+        }
         if(len <= 0) {
             *saveErrno = errno;
             break;
         }
-        if(iov_[0].iov_len + iov_[1].iov_len  == 0) { break; } /* 传输结束 */
-        else if(static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len) {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
-            }
-        }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len; 
-            iov_[0].iov_len -= len; 
-            writeBuff_.Retrieve(len);
+        Sent_(len);
+        if(toWrite_ == 0) {
+            break;
         }
     } while(isET || ToWriteBytes() > 10240);  // do...while是要一次写完
+    UpdatePhase_();
     return len;
 }
 
+// 完成模式的接收：数据由内核读入provided buffer，追加到读缓冲区后交还buffer
+void HttpConn::Received(const char* data, size_t len) {
+    readBuff_.Append(data, len);
+    UpdatePhase_();
+}
+
+// 完成模式的发送：内存块组成的消息由事件循环提交，文件区间仍由write用sendfile发送
+const struct msghdr* HttpConn::SendMsg() {
+    int iovCnt = FillIov_(iov_);
+    if(iovCnt == 0) { return nullptr; }
+    memset(&msg_, 0, sizeof(msg_));
+    msg_.msg_iov = iov_;
+    msg_.msg_iovlen = iovCnt;
+    return &msg_;
+}
+
+// 完成模式的发送：提交的消息发出了len字节
+void HttpConn::Written(size_t len) {
+    Sent_(len);
+    UpdatePhase_();
+}
+
+// 发送链开头连续的内存块填入iov：相邻的响应头与映射的文件由一次writev（sendmsg）发出
+int HttpConn::FillIov_(struct iovec* iov) const {
+    int iovCnt = 0;
+    for(size_t i = chainIdx_; i < chain_.size() && chain_[i].data && iovCnt < MAX_IOV; i++) {
+        iov[iovCnt].iov_base = const_cast<char*>(chain_[i].data);
+        iov[iovCnt].iov_len = chain_[i].len;
+        iovCnt++;
+    }
+    return iovCnt;
+}
+
+// 发送了len字节：全部发完时传输结束
+void HttpConn::Sent_(size_t len) {
+    Advance_(len);
+    if(toWrite_ == 0) {
+        writeBuff_.RetrieveAll();  /* 传输结束 */
+        if(corked_) { SetCork_(false); }  // 取消TCP_CORK，立即发出剩余数据
+    }
+}
+
+// 发送了len字节：跳过已写完的数据块，写了一部分的数据块向后移动
+void HttpConn::Advance_(size_t len) {
+    toWrite_ -= len;
+    sent_ += len;
+    while(len > 0) {
+        Chunk& chunk = chain_[chainIdx_];
+        size_t n = len < chunk.len ? len : chunk.len;
+        if(chunk.data) {
+            chunk.data += n;
+        } else {
+            chunk.offset += n;
+        }
+        chunk.len -= n;
+        len -= n;
+        if(chunk.len == 0) { chainIdx_++; }
+    }
+}
+
+// 设置TCP_CORK：响应头和文件分两次系统调用发送时，避免响应头单独成为一个小报文段
+void HttpConn::SetCork_(bool on) {
+    int opt = on ? 1 : 0;
+    setsockopt(fd_, IPPROTO_TCP, TCP_CORK, &opt, sizeof(opt));
+    corked_ = on;
+}
+
+// 解析出错时对应的响应状态码
+int HttpConn::ErrorCode_(HttpRequest::HTTP_CODE code) {
+    switch(code) {
+    case HttpRequest::TOO_LARGE_REQUEST:
+        return 413;
+    case HttpRequest::INTERNAL_ERROR:
+        return 500;
+    default:
+        return 400;
+    }
+}
+
 // 核心业务逻辑：处理数据请求与响应
+// 缓冲区中所有完整的请求（流水线）一次解析完，响应依次追加到同一条发送链
 bool HttpConn::process() {
-    // 请求数据初始化
-    request_.Init();
-    if(readBuff_.ReadableBytes() <= 0) {
-        return false;
+    for(int i = 0; i < respCnt_; i++) {
+        response_[i].ReleaseFile();  // 上一批已发送完
+    }
+    respCnt_ = 0;
+    while(respCnt_ < MAX_PIPELINE) {
+        // 解析请求：请求不完整时保留解析状态，收到新数据后从停下的位置接着解析
+        HttpRequest::HTTP_CODE code = request_.parse(readBuff_);
+        if(code == HttpRequest::NO_REQUEST) {
+            break;
+        }
+        HttpResponse& response = response_[respCnt_];
+        requestCnt_++;
+        if(code == HttpRequest::GET_REQUEST) {
+            LOG_DEBUG("%s", request_.path().c_str());
+            // 响应数据初始化：达到最大请求数时本响应关闭连接，否则通告剩余的请求数
+            int left = maxKeepAliveRequests > 0 ? maxKeepAliveRequests - requestCnt_ : 0;
+            bool keepAlive = request_.IsKeepAlive() && (maxKeepAliveRequests <= 0 || left > 0);
+            response.Init(srcDir, request_.path(), keepAlive, 200, left);
+            if(request_.method() == "GET") {
+                response.SetRequest(request_);
+            }
+        } else {
+            response.Init(srcDir, request_.path(), false, ErrorCode_(code));
+        }
+        // 创建响应数据，响应头追加到writeBuff_中
+        response.MakeResponse(writeBuff_);
+        respCnt_++;
+        // 不保持连接时之后的请求不再处理
+        if(!response.IsKeepAlive()) {
+            break;
+        }
     }
-    else if(request_.parse(readBuff_)) {
-        // 解析读到的数据，保存在readBuff_中
-        LOG_DEBUG("%s", request_.path().c_str());
-         // 响应数据初始化
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+    if(respCnt_ == 0) {
+        UpdatePhase_();
+        return false;  // 请求不完整，继续读
+    }
+    // 所有响应生成完后再取响应头地址，避免writeBuff_扩容使之前的地址失效
+    chain_.clear();
+    chainIdx_ = 0;
+    toWrite_ = 0;
+    bool hasFileFd = false;
+    const char* head = writeBuff_.Peek();
+    for(int i = 0; i < respCnt_; i++) {
+        for(const HttpResponse::Slice& slice: response_[i].Slices()) {
+            // 响应头（多段响应中为分隔行与段头部）
+            if(slice.textLen > 0) {
+                chain_.push_back({ head, -1, 0, slice.textLen });
+                head += slice.textLen;
+            }
+            // 文件：已映射时作为内存块，sendfile模式下作为文件区间
+            if(slice.len > 0 && response_[i].File()) {
+                chain_.push_back({ response_[i].File() + slice.offset, -1, 0, slice.len });
+            } else if(slice.len > 0 && response_[i].FileFd() >= 0) {
+                chain_.push_back({ nullptr, response_[i].FileFd(), slice.offset, slice.len });
+                hasFileFd = true;
+            }
+        }
+    }
+    for(const Chunk& chunk: chain_) {
+        toWrite_ += chunk.len;
+    }
+    if(useCork && hasFileFd) { SetCork_(true); }
+    UpdatePhase_();
+    LOG_DEBUG("responses:%d, chunks:%zu, to write:%zu", respCnt_, chain_.size(), ToWriteBytes());
+    return true;
+}
+
+// 更新所处阶段：有待发送数据为发送阶段；请求解析到一半（或缓冲区中有未解析的数据）为请求头或请求体阶段；否则为空闲
+void HttpConn::UpdatePhase_() {
+    TIMEOUT_PHASE phase;
+    HttpRequest::PARSE_STATE state = request_.State();
+    if(toWrite_ > 0) {
+        phase = SEND_PHASE;
+    } else if(state == HttpRequest::REQUEST_LINE || state == HttpRequest::FINISH) {
+        phase = readBuff_.ReadableBytes() > 0 ? HEADER_PHASE : IDLE_PHASE;
+    } else if(state == HttpRequest::HEADERS) {
+        phase = HEADER_PHASE;
     } else {
-        response_.Init(srcDir, request_.path(), false, 400);
+        phase = BODY_PHASE;
     }
-    // 解析完请求数据之后开始创建响应数据，响应数据保存在writeBuff_中
-    response_.MakeResponse(writeBuff_);
-    // 响应头: 存在第一块内存中
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ = 1;
-
-    // 文件: 存在第二块内存中
-    if(response_.FileLen() > 0  && response_.File()) {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;
+    // 请求头阶段内收到数据、同一请求连续的发送都不重新计时
+    if(phase == phase_) { return; }
+    phase_ = phase;
+    phaseSince_ = CoarseClock::NowMs();
+    if(phase == SEND_PHASE) {
+        windowSent_ = sent_;
+        windowSince_ = phaseSince_;
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
+}
+
+// 有请求数据到达：只有空闲阶段需要切换，其余阶段由读、处理之后的UpdatePhase_更新
+bool HttpConn::StartRequest() {
+    if(phase_ != IDLE_PHASE) { return false; }
+    phase_ = HEADER_PHASE;
+    phaseSince_ = CoarseClock::NowMs();
     return true;
 }
+
+// 检查超时：发送阶段每满一个窗口检查一次发送量，达到下限则开始下一个窗口
+int HttpConn::CheckTimeout(TIMEOUT_PHASE* phase) {
+    assert(phase);
+    int64_t now = CoarseClock::NowMs();
+    int64_t deadline = now;
+    *phase = phase_;
+    switch(phase_) {
+    case HEADER_PHASE:
+        deadline = headerTimeoutMS > 0 ? phaseSince_ + headerTimeoutMS : now + UNLIMITED_RECHECK_MS;
+        break;
+    case BODY_PHASE:
+        deadline = bodyTimeoutMS > 0 ? phaseSince_ + bodyTimeoutMS : now + UNLIMITED_RECHECK_MS;
+        break;
+    case IDLE_PHASE:
+        deadline = idleTimeoutMS > 0 ? phaseSince_ + idleTimeoutMS : now + UNLIMITED_RECHECK_MS;
+        break;
+    case SEND_PHASE:
+        deadline = windowSince_ + SEND_WINDOW_MS;
+        if(deadline <= now) {
+            if((sent_ - windowSent_) * 1000 < minSendRate * static_cast<uint64_t>(now - windowSince_)) {
+                return 0;
+            }
+            windowSent_ = sent_;
+            windowSince_ = now;
+            deadline = now + SEND_WINDOW_MS;
+        }
+        break;
+    }
+    return deadline > now ? static_cast<int>(deadline - now) : 0;
+}
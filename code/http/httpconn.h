@@ -3,18 +3,31 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
+#include <sys/socket.h>  // msghdr
+#include <sys/sendfile.h> // sendfile
+#include <netinet/tcp.h> // TCP_CORK/TCP_NODELAY
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
 #include <errno.h>      
+#include <vector>
 
 #include "../log/log.h"
 #include "../pool/sqlconnRAII.h"
 #include "../buffer/buffer.h"
+#include "../timer/timingwheel.h"
 #include "httprequest.h"
 #include "httpresponse.h"
 
 class HttpConn {
 public:
+    // 连接所处的阶段：每个阶段有各自的超时
+    enum TIMEOUT_PHASE {
+        HEADER_PHASE,  // 接收请求头：从连接建立或新请求的第一个字节起计时，期间有数据到达也不延长
+        BODY_PHASE,  // 接收请求体：从请求头收完起计时
+        IDLE_PHASE,  // 保持连接空闲：从响应发完起计时
+        SEND_PHASE,  // 发送响应：每个窗口内的发送量不低于minSendRate
+    };
+
     HttpConn();
     ~HttpConn();
 
@@ -24,6 +37,17 @@ public:
     ssize_t read(int* saveErrno);
     // 集中写，传输响应报文
     ssize_t write(int* saveErrno);
+    // 完成模式（io_uring）的接收：内核读入的数据由事件循环追加到读缓冲区
+    void Received(const char* data, size_t len);
+    // 读缓冲区中还未处理的数据量
+    size_t ReadBytes() const { return readBuff_.ReadableBytes(); }
+    // 完成模式的发送：发送链开头连续的内存块组成一个消息，下一块是文件区间或没有待发送数据时返回nullptr
+    // 返回的消息在提交的请求完成之前保持不变
+    const struct msghdr* SendMsg();
+    // 完成模式的发送：提交的请求发出了len字节
+    void Written(size_t len);
+    // 作废当前代数：代数匹配且连接打开时加一，多个关闭方中只有一个成功
+    bool Invalidate(uint32_t gen);
     // 关闭连接
     void Close();
     // 获取文件描述符
@@ -36,18 +60,54 @@ public:
     sockaddr_in GetAddr() const;
     // 处理请求
     bool process();
-    // 返回结构体数组内存的长度
-    int ToWriteBytes() { 
-        return iov_[0].iov_len + iov_[1].iov_len; 
+    // 返回待发送数据的长度
+    size_t ToWriteBytes() const { 
+        return toWrite_; 
     }
-    // 是否保持连接
+    // 是否保持连接：以最后发出的响应为准，错误请求的响应总是关闭连接
     bool IsKeepAlive() const {
-        return request_.IsKeepAlive();
+        return respCnt_ > 0 && response_[respCnt_ - 1].IsKeepAlive();
+    }
+    // 连接代数：奇数表示打开，偶数表示已关闭
+    uint32_t GetGen() const {
+        return gen_.load(std::memory_order_acquire);
+    }
+    // 句柄是否仍指向同一个打开的连接
+    bool IsAlive(uint32_t gen) const {
+        return (gen & 1) && GetGen() == gen;
+    }
+    // 线程池中的任务计数：事件循环分发时加一，工作线程完成时减一
+    void AddTask() { pending_++; }
+    void TaskDone() { pending_--; }
+    bool HasPendingTask() const { return pending_ > 0; }
+    // 推迟的读事件：事件循环收到读事件时上一个任务还没结束，记下连接代数，由该任务结束时交回事件循环
+    void DeferRead(uint32_t gen) { deferredRead_.store(gen); }
+    // 取走推迟的读事件：返回记下的代数，没有时返回0；事件循环与工作线程中只有一方能取到
+    uint32_t TakeDeferredRead() { return deferredRead_.load() ? deferredRead_.exchange(0) : 0; }
+    // 超时定时器节点：由事件循环的时间轮链接，连接对象复用时节点随之复用
+    TimerNode* GetTimerNode() { return &timerNode_; }
+    // 有请求数据到达：空闲的保持连接进入请求头阶段，返回是否发生了切换
+    bool StartRequest();
+    // 检查当前阶段是否超时：返回距到期的毫秒数，已超时返回0；phase为当前阶段
+    // 请求头、请求体、空闲超时为0时该阶段不限时，每隔UNLIMITED_RECHECK_MS检查一次阶段是否已变化
+    // 以下两个函数只在没有线程池任务时由事件循环线程调用
+    int CheckTimeout(TIMEOUT_PHASE* phase);
+    // 所处阶段：只在没有线程池任务时由事件循环线程读取
+    TIMEOUT_PHASE Phase() const { return phase_; }
+    // 是否有阶段限时：全部不限时时不需要定时器
+    static bool HasTimeout() {
+        return headerTimeoutMS > 0 || bodyTimeoutMS > 0 || idleTimeoutMS > 0 || minSendRate > 0;
     }
 
     static bool isET;  // 是否ET模式
+    static bool useCork;  // sendfile发送时是否用TCP_CORK把响应头和文件合并成完整的报文段
     static const char* srcDir;  // 资源目录
     static std::atomic<int> userCount;  // 用户账号
+    static int headerTimeoutMS;  // 请求头超时：0为不限时
+    static int bodyTimeoutMS;  // 请求体超时：0为不限时
+    static int idleTimeoutMS;  // 保持连接空闲超时：0为不限时
+    static size_t minSendRate;  // 最低发送速率：字节/秒，0为不限制
+    static int maxKeepAliveRequests;  // 一个连接最多处理的请求数：达到后的响应关闭连接，0为不限制
     
 private:
    
@@ -55,15 +115,56 @@ private:
     struct  sockaddr_in addr_;  // socke结构体
 
     bool isClose_;  // 是否关闭连接
+    // 每次init和Invalidate各加一：文件描述符被内核复用后，旧任务和定时器持有的代数不再匹配
+    std::atomic<uint32_t> gen_;
+    std::atomic<int> pending_;  // 尚未完成的线程池任务数
+    std::atomic<uint32_t> deferredRead_;  // 推迟的读事件所属的连接代数，0为没有
+    TimerNode timerNode_;  // 超时定时器节点，只在事件循环线程中访问
     
-    int iovCnt_;  // 结构体数组对应的内存标记块
-    struct iovec iov_[2];  // 结构体数组 分别存储响应体和响应数据
+    static const int MAX_PIPELINE = 16;  // 一批最多处理的流水线请求数
+    static const int MAX_IOV = 64;  // 一次writev最多的数据块数
+    static const size_t MAX_READ_BUFF = 64 * 1024;  // ET模式一次最多读入的数据量
+    static const int SEND_WINDOW_MS = 10000;  // 发送速率的统计窗口
+    static const int UNLIMITED_RECHECK_MS = 10000;  // 不限时的阶段重新检查的间隔
+
+    static int ErrorCode_(HttpRequest::HTTP_CODE code);  // 解析出错时的响应状态码
+
+    // 发送链中的数据块：内存块（响应头、映射的文件）或用sendfile发送的文件区间
+    struct Chunk {
+        const char* data;  // 内存块的剩余部分，文件区间为nullptr
+        int fileFd;  // 文件区间的文件描述符
+        off_t offset;  // 文件区间的当前偏移
+        size_t len;  // 剩余长度
+    };
+
+    void Advance_(size_t len);  // 发送了len字节：跳过已发完的数据块
+    void Sent_(size_t len);  // 发送了len字节：全部发完时清空写缓冲区并取消TCP_CORK
+    int FillIov_(struct iovec* iov) const;  // 发送链开头连续的内存块填入iov，返回块数
+    void SetCork_(bool on);  // 设置TCP_CORK
+    void UpdatePhase_();  // 读、处理、写之后按发送链与解析状态更新所处阶段
+
+    // 发送链：每个响应占两块，响应头（在writeBuff_中）和文件
+    // 相邻的内存块由一次writev发出，文件区间用sendfile发送
+    std::vector<Chunk> chain_;
+    size_t chainIdx_;  // 第一个还没发送完的数据块
+    size_t toWrite_;  // 待发送的字节数
+    bool corked_;  // 是否设置了TCP_CORK
+    struct iovec iov_[MAX_IOV];  // 完成模式下提交的消息引用的数据块
+    struct msghdr msg_;
     
     Buffer readBuff_; // 读缓冲区 保存请求数据的内容
     Buffer writeBuff_; // 写缓冲区  保存响应数据的内容
 
     HttpRequest request_;  // HTTP请求对象
-    HttpResponse response_;  // HTTP响应对象
+    HttpResponse response_[MAX_PIPELINE];  // HTTP响应对象：本批每个请求一个，持有各自的文件映射
+    int respCnt_;  // 本批响应数
+    int requestCnt_;  // 本连接已处理的请求数
+
+    TIMEOUT_PHASE phase_;  // 所处阶段
+    int64_t phaseSince_;  // 进入该阶段的时间：单调时间毫秒
+    uint64_t sent_;  // 已发送的总字节数
+    uint64_t windowSent_;  // 当前发送窗口开始时的sent_
+    int64_t windowSince_;  // 当前发送窗口的开始时间
 };
 
 
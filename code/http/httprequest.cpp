@@ -1,6 +1,11 @@
 #include "httprequest.h"
+#include <strings.h>  // strncasecmp
+#include <ctype.h>    // isxdigit
+#include <stdlib.h>   // mkstemp
 using namespace std;
 
+size_t HttpRequest::maxBodySize = 8 << 20;
+
 // 默认的网页路径
 const unordered_set<string> HttpRequest::DEFAULT_HTML{
             "/index", "/register", "/login",
@@ -12,59 +17,291 @@ const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
 
 // 初始化HTTP请求
 void HttpRequest::Init() {
-    method_ = path_ = version_ = body_ = "";
+    method_.clear();
+    path_.clear();
+    version_.clear();
+    body_.clear();
+    if(bodyFd_ >= 0) {
+        close(bodyFd_);
+        bodyFd_ = -1;
+    }
+    bodyLen_ = 0;
+    bodyLeft_ = 0;
     state_ = REQUEST_LINE;
-    header_.clear();
+    headerCnt_ = 0;
+    lineScanned_ = 0;
+    lineTail_ = nullptr;
     post_.clear();
 }
 
 // 是否保持连接
 bool HttpRequest::IsKeepAlive() const {
-    if(header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
+    const string* conn = GetHeader("Connection");
+    if(conn) {
+        return strcasecmp(conn->c_str(), "keep-alive") == 0 && version_ == "1.1";
     }
     return false;
 }
 
+// 获取请求头：请求头数量很少，线性查找比哈希更快
+const string* HttpRequest::GetHeader(const char* key) const {
+    for(size_t i = 0; i < headerCnt_; i++) {
+        if(strcasecmp(header_[i].first.c_str(), key) == 0) {
+            return &header_[i].second;
+        }
+    }
+    return nullptr;
+}
+
+// 未收完的一行是否已超过MAX_LINE：末尾的\r可能属于行尾，不计入长度，与整行收到时的判断一致
+bool HttpRequest::LineTooLong_(const char* begin, const char* end) {
+    size_t len = end - begin;
+    if(len > 0 && end[-1] == '\r') { len--; }
+    return len > MAX_LINE;
+}
+
+// 行尾检查：扫描停下的位置应为\r\n；停在缓冲区末尾（或末尾的\r）说明这一行还没收完
+const char* HttpRequest::LineEnd_(const char* p, const char* end) {
+    if(p == end || (p + 1 == end && *p == '\r')) { return end; }
+    if(*p == '\r' && p[1] == '\n') { return p; }
+    return nullptr;
+}
+
 // 解析数据：核心业务逻辑
-bool HttpRequest::parse(Buffer& buff) {
-    const char CRLF[] = "\r\n"; // 换行符
-    if(buff.ReadableBytes() <= 0) {
-        return false;
+// 解析状态保存在对象中，数据不完整时返回NO_REQUEST，收到更多数据后从停下的位置继续
+HttpRequest::HTTP_CODE HttpRequest::parse(Buffer& buff) {
+    if(state_ == FINISH) {
+        Init();  // 上一个请求已处理完，开始解析下一个
     }
-    // 有可读数据并且解析状态不是结束 就循环读取
-    while(buff.ReadableBytes() && state_ != FINISH) {
-        // 获取一行数据，\r\n为结束标志
-        const char* lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-        std::string line(buff.Peek(), lineEnd);
+    while(state_ != FINISH) {
+        const char* lineBegin = buff.Peek();
+        const char* bufEnd = buff.BeginWriteConst();
+        if(state_ == BODY || state_ == CHUNK_DATA) {
+            // 请求体数据：取走缓冲区中已到达的部分，不必等整个请求体收齐，读缓冲区不会随请求体增长
+            size_t n = min(buff.ReadableBytes(), bodyLeft_);
+            if(n > 0 && !AppendBody_(lineBegin, n)) {
+                return INTERNAL_ERROR;
+            }
+            buff.Retrieve(n);
+            bodyLeft_ -= n;
+            if(bodyLeft_ > 0) {
+                return NO_REQUEST;
+            }
+            if(state_ == BODY) {
+                ParseBody_();
+            } else {
+                state_ = CHUNK_END;
+            }
+            continue;
+        }
+        // 上次这一行停在一个字段中间：只用该字段的字符类校验新数据，字段结束后再解析整行，
+        // 避免慢速客户端每次都重新扫描整行；停在其他位置时（字段很短）重新解析整行
+        if(lineTail_) {
+            if(lineTail_(lineBegin + lineScanned_, bufEnd) == bufEnd) {
+                lineScanned_ = bufEnd - lineBegin;
+                if(LineTooLong_(lineBegin, bufEnd)) {
+                    LOG_WARN("Request line too long");
+                    return BAD_REQUEST;
+                }
+                return NO_REQUEST;
+            }
+            lineTail_ = nullptr;
+        }
+        lineScanned_ = 0;
+        // 直接在缓冲区上解析一行，\r\n为结束标志，行尾在解析时一并找出
+        const char* lineEnd = nullptr;
         // 判断状态
         switch(state_)
         {
         case REQUEST_LINE:
-            if(!ParseRequestLine_(line)) {
-                return false;
+            lineEnd = ParseRequestLine_(lineBegin, bufEnd);
+            if(lineEnd && lineEnd != bufEnd) {
+                ParsePath_();
             }
-            ParsePath_();
             break;    
         case HEADERS: // 解析请求头
-            ParseHeader_(line);
-            // 如果剩下的可读数据<=2 表示没有请求体（因为请求头后有额外的换行）
-            if(buff.ReadableBytes() <= 2) {
-                state_ = FINISH;
+            lineEnd = ParseHeader_(lineBegin, bufEnd);
+            break;
+        case CHUNK_SIZE: // 分块长度行
+            lineEnd = ParseChunkSize_(lineBegin, bufEnd);
+            break;
+        case CHUNK_END: // 块数据后的\r\n
+            lineEnd = LineEnd_(lineBegin, bufEnd);
+            if(lineEnd && lineEnd != bufEnd) {
+                state_ = CHUNK_SIZE;
             }
             break;
-        case BODY:// 解析请求体
-            ParseBody_(line);
+        case TRAILER: // 尾部字段：校验后丢弃，空行表示请求结束
+            lineEnd = HttpScan::SkipText(lineBegin, bufEnd);
+            if(lineEnd == bufEnd) {
+                lineTail_ = HttpScan::SkipText;
+            }
+            lineEnd = LineEnd_(lineEnd, bufEnd);
+            if(lineEnd == lineBegin && lineEnd != bufEnd) {
+                ParseBody_();
+            }
             break;
         default:
             break;
         }
-        // 请求数据行的结尾等于写指针的位置，表示读完了，直接break
-        if(lineEnd == buff.BeginWrite()) { break; }
+        if(!lineEnd) {
+            return BAD_REQUEST;
+        }
+        // 这一行还没收完：记下已扫描的长度，等待更多数据
+        if(lineEnd == bufEnd) {
+            lineScanned_ = bufEnd - lineBegin;
+            if(LineTooLong_(lineBegin, bufEnd)) {
+                LOG_WARN("Request line too long");
+                return BAD_REQUEST;
+            }
+            return NO_REQUEST;
+        }
+        if(static_cast<size_t>(lineEnd - lineBegin) > MAX_LINE) {
+            LOG_WARN("Request line too long");
+            return BAD_REQUEST;
+        }
         // 更新读指针
         buff.RetrieveUntil(lineEnd + 2);
+        if(state_ == BODY) {
+            // 请求头结束：确定请求体的长度和编码
+            HTTP_CODE ret = ParseBodyLength_();
+            if(ret != NO_REQUEST) {
+                return ret;
+            }
+        }
+        else if(state_ == CHUNK_DATA && bodyLen_ + bodyLeft_ > maxBodySize) {
+            LOG_WARN("Request body too large");
+            return TOO_LARGE_REQUEST;
+        }
     }
     LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    return GET_REQUEST;
+}
+
+// 请求头结束：根据Transfer-Encoding和Content-Length确定请求体，返回NO_REQUEST表示继续解析
+// 没有请求体时请求解析完成；请求体超过上限时不再接收，直接返回TOO_LARGE_REQUEST
+// 重复的Content-Length必须取值相同，Transfer-Encoding只能出现一次，否则前后端对请求边界的理解可能不同
+HttpRequest::HTTP_CODE HttpRequest::ParseBodyLength_() {
+    const string* te = nullptr;
+    const string* len = nullptr;
+    for(size_t i = 0; i < headerCnt_; i++) {
+        const string& name = header_[i].first;
+        const string& value = header_[i].second;
+        if(strcasecmp(name.c_str(), "Transfer-Encoding") == 0) {
+            if(te) {
+                LOG_ERROR("Duplicate Transfer-Encoding");
+                return BAD_REQUEST;
+            }
+            te = &value;
+        }
+        else if(strcasecmp(name.c_str(), "Content-Length") == 0) {
+            if(len && *len != value) {
+                LOG_ERROR("Conflicting Content-Length");
+                return BAD_REQUEST;
+            }
+            len = &value;
+        }
+    }
+    if(te) {
+        // 同时带Content-Length的请求有请求走私的风险，只支持chunked编码
+        if(len || strcasecmp(te->c_str(), "chunked") != 0) {
+            LOG_ERROR("Transfer-Encoding Error");
+            return BAD_REQUEST;
+        }
+        state_ = CHUNK_SIZE;
+        return NO_REQUEST;
+    }
+    if(len) {
+        if(len->empty() || len->size() > 18 || len->find_first_not_of("0123456789") != string::npos) {
+            LOG_ERROR("Content-Length Error");
+            return BAD_REQUEST;
+        }
+        bodyLeft_ = strtoull(len->c_str(), nullptr, 10);
+    }
+    if(bodyLeft_ > maxBodySize) {
+        LOG_WARN("Request body too large: %zu", bodyLeft_);
+        return TOO_LARGE_REQUEST;
+    }
+    if(bodyLeft_ == 0) {
+        ParseBody_();
+    }
+    return NO_REQUEST;
+}
+
+// 处理逻辑：解析分块长度行  格式：十六进制长度[;扩展]，长度为0表示最后一块
+const char* HttpRequest::ParseChunkSize_(const char* begin, const char* end) {
+    const char* p = begin;
+    size_t size = 0;
+    for(; p < end && isxdigit(static_cast<unsigned char>(*p)); p++) {
+        int digit = isdigit(static_cast<unsigned char>(*p)) ? *p - '0' : (*p | 0x20) - 'a' + 10;
+        if(size <= maxBodySize) { size = size * 16 + digit; }  // 超过上限后不再累加，防止溢出
+    }
+    if(p == end) { return end; }
+    if(p == begin || (*p != '\r' && *p != ';' && *p != ' ' && *p != '\t')) {
+        LOG_ERROR("Chunk Size Error");
+        return nullptr;
+    }
+    // 块扩展：校验后忽略
+    const char* extEnd = HttpScan::SkipText(p, end);
+    if(extEnd == end) {
+        lineTail_ = HttpScan::SkipText;
+        return end;
+    }
+    const char* lineEnd = LineEnd_(extEnd, end);
+    if(!lineEnd || lineEnd == end) { return lineEnd; }
+    if(size == 0) {
+        state_ = TRAILER;
+    } else {
+        bodyLeft_ = size;
+        state_ = CHUNK_DATA;
+    }
+    return lineEnd;
+}
+
+// 追加请求体：较小的请求体保存在内存中，超过BODY_MEM_LIMIT后转存到临时文件
+bool HttpRequest::AppendBody_(const char* data, size_t len) {
+    if(bodyFd_ < 0 && body_.size() + len > BODY_MEM_LIMIT) {
+        bodyFd_ = OpenTempFile_();
+        if(bodyFd_ < 0 || !WriteAll_(bodyFd_, body_.data(), body_.size())) {
+            LOG_ERROR("Spool request body error!");
+            return false;
+        }
+        body_.clear();
+        body_.shrink_to_fit();
+    }
+    bodyLen_ += len;
+    if(bodyFd_ >= 0) {
+        if(!WriteAll_(bodyFd_, data, len)) {
+            LOG_ERROR("Spool request body error!");
+            return false;
+        }
+        return true;
+    }
+    body_.append(data, len);
+    return true;
+}
+
+// 创建临时文件：创建后立即删除目录项，文件随描述符关闭自动释放
+int HttpRequest::OpenTempFile_() {
+    char path[] = "/tmp/webserver-body-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd >= 0) {
+        unlink(path);
+    }
+    return fd;
+}
+
+// 写满len字节
+bool HttpRequest::WriteAll_(int fd, const char* data, size_t len) {
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+        if(n < 0) {
+            if(errno == EINTR) { continue; }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
     return true;
 }
 
@@ -83,39 +320,96 @@ void HttpRequest::ParsePath_() {
     }
 }
 
-// 处理逻辑：解析请求行
-bool HttpRequest::ParseRequestLine_(const string& line) {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {   
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
-        return true;
+// 处理逻辑：解析请求行  格式：方法 空格 路径 空格 HTTP/版本（1.0或1.1）
+// 方法和版本必须是token字符，路径不能含空格和控制字符；数据不足时不修改任何状态
+const char* HttpRequest::ParseRequestLine_(const char* begin, const char* end) {
+    const char* sp1 = HttpScan::SkipToken(begin, end);
+    if(sp1 == end) {
+        lineTail_ = HttpScan::SkipToken;
+        return end;
+    }
+    if(sp1 != begin && *sp1 == ' ') {
+        const char* sp2 = HttpScan::SkipUri(sp1 + 1, end);
+        if(sp2 == end) {
+            lineTail_ = HttpScan::SkipUri;
+            return end;
+        }
+        size_t avail = end - sp2 - 1;
+        if(sp2 != sp1 + 1 && *sp2 == ' ' && memcmp(sp2 + 1, "HTTP/", avail < 5 ? avail : 5) == 0) {
+            if(avail <= 5) { return end; }
+            const char* verEnd = HttpScan::SkipToken(sp2 + 6, end);
+            const char* lineEnd = LineEnd_(verEnd, end);
+            if(lineEnd == end) { return end; }
+            // 只支持HTTP/1.0与HTTP/1.1
+            if(lineEnd && verEnd - sp2 == 9 &&
+               (memcmp(sp2 + 6, "1.1", 3) == 0 || memcmp(sp2 + 6, "1.0", 3) == 0)) {
+                method_.assign(begin, sp1);
+                path_.assign(sp1 + 1, sp2);
+                version_.assign(sp2 + 6, verEnd);
+                state_ = HEADERS;
+                return lineEnd;
+            }
+        }
     }
     LOG_ERROR("RequestLine Error");
-    return false;
+    return nullptr;
 }
 
-// 处理逻辑：解析请求头
-void HttpRequest::ParseHeader_(const string& line) {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
+// 处理逻辑：解析请求头  格式：名称:[空白]值[空白]，空行表示请求头结束
+// 名称必须是token字符，值不能含\t以外的控制字符，扫描值的同时找到行尾；数据不足时不修改任何状态
+const char* HttpRequest::ParseHeader_(const char* begin, const char* end) {
+    if(begin == end) { return end; }
+    if(*begin == '\r') {
+        const char* lineEnd = LineEnd_(begin, end);
+        if(lineEnd && lineEnd != end) { state_ = BODY; }
+        return lineEnd;
     }
-    else {
-        state_ = BODY;
+    const char* colon = HttpScan::SkipToken(begin, end);
+    if(colon == end) {
+        lineTail_ = HttpScan::SkipToken;
+        return end;
+    }
+    if(colon == begin || *colon != ':') {
+        LOG_ERROR("Header Error");
+        return nullptr;
+    }
+    const char* value = colon + 1;
+    while(value < end && (*value == ' ' || *value == '\t')) { value++; }
+    const char* textEnd = HttpScan::SkipText(value, end);
+    if(textEnd == end) {
+        lineTail_ = HttpScan::SkipText;
+        return end;
+    }
+    const char* lineEnd = LineEnd_(textEnd, end);
+    if(!lineEnd) {
+        LOG_ERROR("Header Error");
+        return nullptr;
+    }
+    if(lineEnd == end) { return end; }
+    const char* valueEnd = lineEnd;
+    while(valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) { valueEnd--; }
+    if(headerCnt_ >= MAX_HEADERS) {
+        LOG_ERROR("Too many headers");
+        return nullptr;
     }
+    if(headerCnt_ == header_.size()) {
+        header_.emplace_back();
+    }
+    header_[headerCnt_].first.assign(begin, colon);
+    header_[headerCnt_].second.assign(value, valueEnd);
+    headerCnt_++;
+    return lineEnd;
 }
 
-// 处理逻辑：解析请求体
-void HttpRequest::ParseBody_(const string& line) {
-    body_ = line;
-    ParsePost_();
+// 处理逻辑：请求体接收完成，内存中的表单数据在这里解析
+void HttpRequest::ParseBody_() {
+    if(bodyFd_ < 0) {
+        ParsePost_();
+        LOG_DEBUG("Body:%s, len:%d", body_.c_str(), body_.size());
+    } else {
+        LOG_DEBUG("Body spooled to file, len:%zu", bodyLen_);
+    }
     state_ = FINISH;
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
 }
 
 // 加密操作：转换为十六进制
@@ -128,7 +422,8 @@ int HttpRequest::ConverHex(char ch) {
 // 处理POST请求：注册登录提交表单
 void HttpRequest::ParsePost_() {
     // 判断是否是POST，内容是否是表单数据
-    if(method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    const string* type = GetHeader("Content-Type");
+    if(method_ == "POST" && type && *type == "application/x-www-form-urlencoded") {
         // 解析表单信息
         ParseFromUrlencoded_();  
         if(DEFAULT_HTML_TAG.count(path_)) {
@@ -170,6 +465,7 @@ void HttpRequest::ParseFromUrlencoded_() {
             body_[i] = ' ';
             break;
         case '%':
+            if(i + 2 >= n) { break; }  // 不完整的%编码按原样保留
             // 简单的加密操作  转换为十六进制加密
             num = ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2]);
             body_[i + 2] = num % 10 + '0';
@@ -198,8 +494,11 @@ bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin
     if(name == "" || pwd == "") { return false; }
     LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
     MYSQL* sql;
-    SqlConnRAII(&sql,  SqlConnPool::Instance());
-    assert(sql);
+    SqlConnRAII sqlRAII(&sql,  SqlConnPool::Instance());
+    if(!sql) {
+        LOG_ERROR("UserVerify: no sql connection");
+        return false;
+    }
     
     bool flag = false;
     unsigned int j = 0;
@@ -251,7 +550,6 @@ bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin
         }
         flag = true;
     }
-    SqlConnPool::Instance()->FreeConn(sql);
     LOG_DEBUG( "UserVerify success!!");
     return flag;
 }
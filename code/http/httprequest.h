@@ -3,12 +3,14 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <string>
-#include <regex>
 #include <errno.h>     
+#include <unistd.h>    // close
 #include <mysql/mysql.h>  //mysql
 
 #include "../buffer/buffer.h"
+#include "httpscan.h"
 #include "../log/log.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/sqlconnRAII.h"
@@ -20,7 +22,11 @@ public:
     enum PARSE_STATE {
         REQUEST_LINE,  // 正在解析首行
         HEADERS,  // 投头
-        BODY,  // 体
+        BODY,  // 体：按Content-Length接收
+        CHUNK_SIZE,  // 分块长度行
+        CHUNK_DATA,  // 块数据
+        CHUNK_END,  // 块数据后的\r\n
+        TRAILER,  // 最后一块之后的尾部字段
         FINISH,  // 完成   
     };
 
@@ -34,15 +40,18 @@ public:
         FILE_REQUEST,// 文件请求
         INTERNAL_ERROR, // 内部错误
         CLOSED_CONNECTION,// 连接关闭
+        TOO_LARGE_REQUEST,// 请求体过大
     };
     
-    HttpRequest() { Init(); }
-    ~HttpRequest() = default;
+    HttpRequest() : bodyFd_(-1) { Init(); }
+    ~HttpRequest() { if(bodyFd_ >= 0) close(bodyFd_); }
 
     // 初始化HTTP请求状态
     void Init();
-    // 解析函数
-    bool parse(Buffer& buff);
+    // 解析函数：可多次调用，每次从上次停下的位置继续
+    // 返回NO_REQUEST表示请求还不完整，GET_REQUEST表示解析完成，BAD_REQUEST表示格式错误
+    // 上一个请求解析完成后再次调用时自动开始解析下一个请求
+    HTTP_CODE parse(Buffer& buff);
 
     std::string path() const;
     std::string& path();
@@ -50,13 +59,29 @@ public:
     std::string version() const;
     std::string GetPost(const std::string& key) const;// 获取Post表单
     std::string GetPost(const char* key) const;
+    const std::string* GetHeader(const char* key) const;// 获取请求头：不区分大小写，不存在返回nullptr
+    const std::string& body() const { return body_; }// 内存中的请求体
+    int BodyFd() const { return bodyFd_; }// 转存请求体的临时文件，请求体在内存中时为-1
+    size_t BodyLen() const { return bodyLen_; }// 请求体长度
+
+    static size_t maxBodySize;  // 请求体最大长度：超过时返回413
 
     bool IsKeepAlive() const;// 是否保持连接
+    PARSE_STATE State() const { return state_; }// 解析状态
 
 private:
-    bool ParseRequestLine_(const std::string& line);// 解析请求首行
-    void ParseHeader_(const std::string& line); // 解析请求头
-    void ParseBody_(const std::string& line);// 解析请求体
+    // 以下解析函数直接在Buffer的[begin, end)上扫描，查找分隔符的同时校验字符，不拷贝整行
+    // 返回本行\r\n的位置（没有行尾时为end），格式错误返回nullptr
+    const char* ParseRequestLine_(const char* begin, const char* end);// 解析请求首行
+    const char* ParseHeader_(const char* begin, const char* end); // 解析请求头
+    const char* ParseChunkSize_(const char* begin, const char* end);// 解析分块长度行
+    void ParseBody_();// 请求体接收完成
+    static const char* LineEnd_(const char* p, const char* end);// p处应为行尾：是则返回p，数据不足返回end，否则返回nullptr
+    static bool LineTooLong_(const char* begin, const char* end);// 未收完的一行是否已超过MAX_LINE
+    HTTP_CODE ParseBodyLength_();// 请求头结束：确定请求体长度和编码
+    bool AppendBody_(const char* data, size_t len);// 追加请求体数据
+    static int OpenTempFile_();// 创建转存请求体的临时文件
+    static bool WriteAll_(int fd, const char* data, size_t len);// 写满len字节
 
     void ParsePath_();// 解析请求路径
     void ParsePost_();// 解析post请求
@@ -66,9 +91,21 @@ private:
 
     PARSE_STATE state_;  // 解析的状态
     std::string method_, path_, version_, body_;  // 方法 路径 协议版本 请求体
-    std::unordered_map<std::string, std::string> header_;  // 请求头
+    // 请求头：Init只重置headerCnt_，字符串的容量在同一连接的多个请求间复用，解析时不再分配内存
+    std::vector<std::pair<std::string, std::string>> header_;
+    size_t headerCnt_;  // 当前请求的请求头数量
+    int bodyFd_;  // 请求体超过BODY_MEM_LIMIT时转存的临时文件
+    size_t bodyLen_;  // 已接收的请求体长度
+    size_t bodyLeft_;  // 当前请求体（或当前块）还未接收的长度
+    size_t lineScanned_;  // 当前行已校验但还没收到行尾的字节数
+    // 当前行停在一个字段中间时该字段的扫描函数：下次从lineScanned_处用它校验新数据，为空时重新解析整行
+    const char* (*lineTail_)(const char* begin, const char* end);
     std::unordered_map<std::string, std::string> post_;  // post请求表单数据
 
+    static const size_t MAX_LINE = 8192;  // 请求行、请求头单行的最大长度
+    static const size_t MAX_HEADERS = 100;  // 请求头的最大数量
+    static const size_t BODY_MEM_LIMIT = 64 * 1024;  // 请求体超过该长度时转存到临时文件
+
     static const std::unordered_set<std::string> DEFAULT_HTML;  // 默认网页
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;// 用户注册登录网页路径
     static int ConverHex(char ch);  // 转换成十六进制
@@ -0,0 +1,173 @@
+// 请求解析基准：当前的HttpRequest::parse与原来的正则解析（每行拷贝成string后regex_match）对比
+// 每次把完整的请求写入Buffer后解析一次，统计每个请求的纳秒数
+// 用法：httprequest_bench [每种请求的解析次数]
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "httprequest.h"
+
+using namespace std;
+
+namespace {
+
+// 原来的解析：请求行、请求头各用一个正则匹配，请求头存入unordered_map
+class RegexRequest {
+public:
+    void Init() {
+        method_ = path_ = version_ = body_ = "";
+        state_ = REQUEST_LINE;
+        header_.clear();
+    }
+
+    bool parse(Buffer& buff) {
+        const char CRLF[] = "\r\n";
+        if(buff.ReadableBytes() <= 0) {
+            return false;
+        }
+        while(buff.ReadableBytes() && state_ != FINISH) {
+            const char* lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
+            string line(buff.Peek(), lineEnd);
+            switch(state_)
+            {
+            case REQUEST_LINE:
+                if(!ParseRequestLine_(line)) {
+                    return false;
+                }
+                ParsePath_();
+                break;
+            case HEADERS:
+                ParseHeader_(line);
+                if(buff.ReadableBytes() <= 2) {
+                    state_ = FINISH;
+                }
+                break;
+            case BODY:
+                body_ = line;
+                state_ = FINISH;
+                break;
+            default:
+                break;
+            }
+            if(lineEnd == buff.BeginWrite()) { break; }
+            buff.RetrieveUntil(lineEnd + 2);
+        }
+        return true;
+    }
+
+    const string& path() const { return path_; }
+
+private:
+    enum PARSE_STATE { REQUEST_LINE, HEADERS, BODY, FINISH };
+
+    void ParsePath_() {
+        static const unordered_set<string> DEFAULT_HTML{
+            "/index", "/register", "/login", "/welcome", "/video", "/picture", };
+        if(path_ == "/") {
+            path_ = "/index.html";
+        }
+        else {
+            for(auto &item: DEFAULT_HTML) {
+                if(item == path_) {
+                    path_ += ".html";
+                    break;
+                }
+            }
+        }
+    }
+
+    bool ParseRequestLine_(const string& line) {
+        regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+        smatch subMatch;
+        if(regex_match(line, subMatch, patten)) {
+            method_ = subMatch[1];
+            path_ = subMatch[2];
+            version_ = subMatch[3];
+            state_ = HEADERS;
+            return true;
+        }
+        return false;
+    }
+
+    void ParseHeader_(const string& line) {
+        regex patten("^([^:]*): ?(.*)$");
+        smatch subMatch;
+        if(regex_match(line, subMatch, patten)) {
+            header_[subMatch[1]] = subMatch[2];
+        }
+        else {
+            state_ = BODY;
+        }
+    }
+
+    PARSE_STATE state_;
+    string method_, path_, version_, body_;
+    unordered_map<string, string> header_;
+};
+
+const char BROWSER[] =
+    "GET /picture HTTP/1.1\r\n"
+    "Host: 192.168.1.100:1316\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/120.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+    "image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+    "Referer: http://192.168.1.100:1316/index.html\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n";
+
+// 返回每个请求的纳秒数
+template<class Parse>
+double Run(const string& req, int iters, Parse parse) {
+    Buffer buff;
+    auto t0 = chrono::steady_clock::now();
+    for(int i = 0; i < iters; i++) {
+        buff.Append(req.data(), req.size());
+        parse(buff);
+        buff.RetrieveAll();
+    }
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / iters;
+}
+
+void Report(const char* name, const string& req, int iters) {
+    RegexRequest oldReq;
+    HttpRequest newReq;
+    string oldPath, newPath;
+    double oldNs = Run(req, iters / 10, [&](Buffer& buff) {
+        oldReq.Init();
+        oldReq.parse(buff);
+    });
+    oldPath = oldReq.path();
+    double newNs = Run(req, iters, [&](Buffer& buff) {
+        if(newReq.parse(buff) != HttpRequest::GET_REQUEST) {
+            fprintf(stderr, "%s: parse failed\n", name);
+            exit(1);
+        }
+    });
+    newPath = newReq.path();
+    printf("%-8s %5zu bytes   regex %8.0f ns/req   scan %6.0f ns/req   %5.1fx   (%s / %s)\n", name, req.size(),
+           oldNs, newNs, oldNs / newNs, oldPath.c_str(), newPath.c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iters = argc > 1 ? atoi(argv[1]) : 200000;
+
+    Report("minimal", "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n", iters);
+    Report("browser", string(BROWSER) + "\r\n", iters);
+    string cookie = "Cookie: ";
+    for(int i = 0; i < 16; i++) {
+        cookie += "session_" + to_string(i) + "=0123456789abcdef0123456789abcdef0123456789abcdef; ";
+    }
+    cookie += "theme=dark\r\n";
+    Report("cookie", string(BROWSER) + cookie + "\r\n", iters);
+    return 0;
+}
@@ -0,0 +1,216 @@
+// 请求解析的模糊测试驱动：同一段输入按不同方式切分后逐段送入HttpRequest::parse，
+// 解析出的请求序列与最终结果必须与一次性送入时完全一致，同时由AddressSanitizer/UBSan检查越界与未定义行为
+// 用法：httprequest_fuzz [-runs=N] 语料文件或目录...
+// 每个语料文件除原样测试外，再做N次随机变异（默认200），随机数种子固定，结果可复现
+// 用clang -fsanitize=fuzzer编译并定义HTTP_FUZZ_LIBFUZZER时，只提供LLVMFuzzerTestOneInput，由libFuzzer驱动
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include "httprequest.h"
+
+using namespace std;
+
+namespace {
+
+// 一次解析的结果：依次解析出的请求，以及最后一次parse的返回值
+struct Outcome {
+    vector<string> requests;
+    int last;
+
+    bool operator==(const Outcome& o) const { return requests == o.requests && last == o.last; }
+};
+
+string Describe_(const HttpRequest& req) {
+    char len[32];
+    snprintf(len, sizeof(len), "%zu", req.BodyLen());
+    return req.method() + "|" + req.path() + "|" + req.version() + "|" +
+           (req.IsKeepAlive() ? "keep-alive" : "close") + "|" + len + "|" + req.body();
+}
+
+// 按cuts切分输入（递增的切分位置），每段到达后反复调用parse，与HttpConn处理流水线请求的方式相同
+Outcome Run_(const uint8_t* data, size_t size, const vector<size_t>& cuts) {
+    HttpRequest req;
+    Buffer buff;
+    Outcome out;
+    out.last = HttpRequest::NO_REQUEST;
+    size_t pos = 0;
+    for(size_t i = 0; i <= cuts.size(); i++) {
+        size_t next = i < cuts.size() ? cuts[i] : size;
+        buff.Append(reinterpret_cast<const char*>(data + pos), next - pos);
+        pos = next;
+        while(true) {
+            HttpRequest::HTTP_CODE code = req.parse(buff);
+            if(code == HttpRequest::GET_REQUEST) {
+                out.requests.push_back(Describe_(req));
+                continue;
+            }
+            if(code != HttpRequest::NO_REQUEST) {
+                out.last = code;
+                return out;
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+uint64_t Next_(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+void Print_(const char* name, const Outcome& out) {
+    fprintf(stderr, "%s: %zu requests, last code %d\n", name, out.requests.size(), out.last);
+    for(const string& r : out.requests) { fprintf(stderr, "  %s\n", r.c_str()); }
+}
+
+void Fail_(const uint8_t* data, size_t size, const char* how, const Outcome& whole, const Outcome& split) {
+    fprintf(stderr, "parse result differs when split %s, input (%zu bytes):\n", how, size);
+    for(size_t i = 0; i < size; i++) {
+        if(isprint(data[i])) {
+            fputc(data[i], stderr);
+        } else {
+            fprintf(stderr, "\\x%02x", data[i]);
+        }
+    }
+    fprintf(stderr, "\n");
+    Print_("whole", whole);
+    Print_("split", split);
+    abort();
+}
+
+// 切分后的结果与一次性送入的结果比较
+void Check_(const uint8_t* data, size_t size, const vector<size_t>& cuts, const char* how, const Outcome& whole) {
+    Outcome split = Run_(data, size, cuts);
+    if(!(split == whole)) { Fail_(data, size, how, whole, split); }
+}
+
+} // namespace
+
+// 单个输入：一次性送入为基准，与逐字节、每个二分点（短输入）和随机切分的结果比较
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    const Outcome whole = Run_(data, size, vector<size_t>());
+
+    vector<size_t> cuts;
+    for(size_t i = 1; i < size; i++) { cuts.push_back(i); }
+    Check_(data, size, cuts, "byte by byte", whole);
+
+    if(size <= 1024) {
+        for(size_t i = 1; i < size; i++) {
+            Check_(data, size, vector<size_t>(1, i), "in two", whole);
+        }
+    }
+
+    uint64_t seed = size * 0x9e3779b97f4a7c15ULL + 1;
+    for(int round = 0; round < 16 && size > 1; round++) {
+        cuts.clear();
+        for(size_t i = Next_(&seed) % 64 + 1; i < size; i += Next_(&seed) % 64 + 1) {
+            cuts.push_back(i);
+        }
+        Check_(data, size, cuts, "randomly", whole);
+    }
+    return 0;
+}
+
+#ifndef HTTP_FUZZ_LIBFUZZER
+namespace {
+
+// 变异：翻转、替换为分隔符或控制字符、插入、删除、复制一段
+string Mutate_(const string& in, uint64_t* seed) {
+    static const char SPECIAL[] = "\r\n: \t;0F\x7f\x80\x00";
+    string s = in;
+    int n = Next_(seed) % 4 + 1;
+    for(int k = 0; k < n; k++) {
+        size_t pos = s.empty() ? 0 : Next_(seed) % s.size();
+        switch(Next_(seed) % 5) {
+        case 0:
+            if(!s.empty()) { s[pos] ^= static_cast<char>(1 << (Next_(seed) % 8)); }
+            break;
+        case 1:
+            if(!s.empty()) { s[pos] = SPECIAL[Next_(seed) % (sizeof(SPECIAL) - 1)]; }
+            break;
+        case 2:
+            s.insert(pos, 1, SPECIAL[Next_(seed) % (sizeof(SPECIAL) - 1)]);
+            break;
+        case 3:
+            if(!s.empty()) { s.erase(pos, Next_(seed) % 16 + 1); }
+            break;
+        default:
+            if(!s.empty()) { s.insert(pos, s.substr(pos, Next_(seed) % 64 + 1)); }
+            break;
+        }
+    }
+    return s;
+}
+
+bool ReadFile_(const string& path, string* out) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(!fp) { return false; }
+    char buf[4096];
+    size_t n;
+    out->clear();
+    while((n = fread(buf, 1, sizeof(buf), fp)) > 0) { out->append(buf, n); }
+    fclose(fp);
+    return true;
+}
+
+void CollectFiles_(const string& path, vector<string>* files) {
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) { return; }
+    if(!S_ISDIR(st.st_mode)) {
+        files->push_back(path);
+        return;
+    }
+    DIR* dir = opendir(path.c_str());
+    if(!dir) { return; }
+    while(struct dirent* ent = readdir(dir)) {
+        if(ent->d_name[0] != '.') { CollectFiles_(path + "/" + ent->d_name, files); }
+    }
+    closedir(dir);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int runs = 200;
+    vector<string> files;
+    for(int i = 1; i < argc; i++) {
+        if(strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = atoi(argv[i] + 6);
+        } else {
+            CollectFiles_(argv[i], &files);
+        }
+    }
+    if(files.empty()) {
+        fprintf(stderr, "usage: %s [-runs=N] corpus...\n", argv[0]);
+        return 1;
+    }
+    size_t inputs = 0;
+    uint64_t seed = 88172645463325252ULL;
+    for(const string& file : files) {
+        string data;
+        if(!ReadFile_(file, &data)) {
+            fprintf(stderr, "cannot read %s\n", file.c_str());
+            return 1;
+        }
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+        inputs++;
+        for(int r = 0; r < runs; r++) {
+            string m = Mutate_(data, &seed);
+            LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(m.data()), m.size());
+            inputs++;
+        }
+    }
+    printf("%zu corpus files, %zu inputs, all splits consistent\n", files.size(), inputs);
+    return 0;
+}
+#endif
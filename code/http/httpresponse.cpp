@@ -2,191 +2,441 @@
 
 using namespace std;
 
-// 支持的文件后缀类型
-const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
-    { ".html",  "text/html" },
-    { ".xml",   "text/xml" },
-    { ".xhtml", "application/xhtml+xml" },
-    { ".txt",   "text/plain" },
-    { ".rtf",   "application/rtf" },
-    { ".pdf",   "application/pdf" },
-    { ".word",  "application/nsword" },
-    { ".png",   "image/png" },
-    { ".gif",   "image/gif" },
-    { ".jpg",   "image/jpeg" },
-    { ".jpeg",  "image/jpeg" },
-    { ".au",    "audio/basic" },
-    { ".mpeg",  "video/mpeg" },
-    { ".mpg",   "video/mpeg" },
-    { ".avi",   "video/x-msvideo" },
-    { ".gz",    "application/x-gzip" },
-    { ".tar",   "application/x-tar" },
-    { ".css",   "text/css "},
-    { ".js",    "text/javascript "},
-};
+bool HttpResponse::useSendfile = false;
 
 // 响应状态码对应的状态描述
 const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     { 200, "OK" },
+    { 206, "Partial Content" },
+    { 304, "Not Modified" },
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 413, "Payload Too Large" },
+    { 416, "Range Not Satisfiable" },
+    { 500, "Internal Server Error" },
 };
 
+// 响应状态码对应的完整响应行：启动时由CODE_STATUS生成
+static unordered_map<int, string> MakeStatusLines_(const unordered_map<int, string>& codeStatus) {
+    unordered_map<int, string> lines;
+    for(const auto& status: codeStatus) {
+        lines[status.first] = "HTTP/1.1 " + to_string(status.first) + " " + status.second + "\r\n";
+    }
+    return lines;
+}
+
+const unordered_map<int, string> HttpResponse::STATUS_LINE = MakeStatusLines_(HttpResponse::CODE_STATUS);
+
 // 响应状态码对应的网页路径
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
     { 400, "/400.html" },
     { 403, "/403.html" },
     { 404, "/404.html" },
+    { 413, "/413.html" },
+    { 416, "/416.html" },
+    { 500, "/500.html" },
 };
 
+unordered_map<int, string> HttpResponse::errorResponses_[2];
+const string HttpResponse::connHeaders_[2] = { "Connection: close\r\n", "Connection: keep-alive\r\n" };
+string HttpResponse::keepAliveTimeout_;
+
+// 多段响应的分隔符：按启动时间与进程号生成，与文件内容冲突的可能可以忽略
+static string MakeBoundary_() {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%08lx%08x", static_cast<unsigned long>(time(nullptr)), static_cast<unsigned>(getpid()));
+    return buf;
+}
+
+const string HttpResponse::BOUNDARY = MakeBoundary_();
+
 HttpResponse::HttpResponse() {
     code_ = -1;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
-    mmFile_ = nullptr; 
-    mmFileStat_ = { 0 };
+    keepAliveLeft_ = 0;
 };
 
 HttpResponse::~HttpResponse() {
-    UnmapFile();
+    ReleaseFile();
 }
 
 // HTTP响应初始化
-void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, int code){
+void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, int code, int keepAliveLeft){
     assert(srcDir != "");
-    if(mmFile_) { UnmapFile(); }// 内存映射
+    ReleaseFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
+    keepAliveLeft_ = keepAliveLeft;
     path_ = path;
     srcDir_ = srcDir;
-    mmFile_ = nullptr; 
-    mmFileStat_ = { 0 };
+    range_.clear();
+    ifRange_.clear();
+    ifNoneMatch_.clear();
+    ifModifiedSince_.clear();
+    acceptEncoding_.clear();
+}
+
+// 记录与GET请求相关的请求头：string复用容量，同一连接的后续请求不再分配内存
+void HttpResponse::SetRequest(const HttpRequest& request) {
+    string* fields[] = { &range_, &ifRange_, &ifNoneMatch_, &ifModifiedSince_, &acceptEncoding_ };
+    const char* names[] = { "Range", "If-Range", "If-None-Match", "If-Modified-Since", "Accept-Encoding" };
+    for(int i = 0; i < 5; i++) {
+        const string* value = request.GetHeader(names[i]);
+        if(value) {
+            *fields[i] = *value;
+        } else {
+            fields[i]->clear();
+        }
+    }
 }
 
 // 创建响应：核心业务逻辑
 void HttpResponse::MakeResponse(Buffer& buff) {
-    /* 判断请求的资源文件 */
-    if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
-        code_ = 404;
+    /* 判断请求的资源文件：请求本身出错时直接返回对应的错误页 */
+    if(code_ < 400) {
+        int err = 0;
+        file_ = FileCache::Instance()->Get(srcDir_ + path_, &err);
+        if(!file_) {
+            code_ = (err == EACCES) ? 403 : 404;
+        }
+        else if(code_ == -1) {
+            code_ = 200;
+        }
+    }
+    slices_.clear();
+    size_t begin = buff.ReadableBytes();
+    size_t fileSize = file_ ? file_->size : 0;
+    // 选定编码版本后，条件请求与Range都针对该版本
+    if(code_ == 200 && file_->compressible && !acceptEncoding_.empty()) {
+        SelectEncoding_();
     }
-    else if(!(mmFileStat_.st_mode & S_IROTH)) {
-        code_ = 403;
+    // 先判断条件请求，再判断Range（RFC 7232 第6节）
+    if(code_ == 200 && NotModified_()) {
+        code_ = 304;
     }
-    else if(code_ == -1) { 
-        code_ = 200; 
+    else if(code_ == 200 && !range_.empty() && IfRange_()) {
+        code_ = ParseRange_();
     }
-    ErrorHtml_();
     AddStateLine_(buff);
-    AddHeader_(buff);
-    AddContent_(buff);
+    AddDate_(buff);
+    AddKeepAlive_(buff);
+    // 未修改：只发送验证相关的响应头，不发送文件
+    if(code_ == 304) {
+        buff.Append(file_->notModified[isKeepAlive_]);
+        slices_.push_back({ buff.ReadableBytes() - begin, 0, 0 });
+        return;
+    }
+    if(code_ == 206) {
+        AddRangeContent_(buff, begin);
+        return;
+    }
+    if(code_ == 416) {
+        buff.Append("Content-Range: bytes */" + to_string(fileSize) + "\r\n");
+    }
+    // 错误响应：错误页已在内存中，不访问文件系统
+    if(code_ >= 400) {
+        file_.reset();
+        AddErrorContent_(buff);
+        slices_.push_back({ buff.ReadableBytes() - begin, 0, 0 });
+        return;
+    }
+    // 文件的响应头已在缓存项中生成好，直接复制
+    buff.Append(file_->headers[isKeepAlive_]);
+    slices_.push_back({ buff.ReadableBytes() - begin, 0, file_->size });
+}
+
+// Keep-Alive响应头的timeout：通告的值与连接实际执行的空闲超时一致
+void HttpResponse::InitKeepAlive(int timeoutMS) {
+    keepAliveTimeout_ = timeoutMS > 0 ? "timeout=" + to_string(timeoutMS / 1000) : "";
+}
+
+// 启动时把错误页读入内存：错误页读取失败时使用错误信息网页
+// 错误页只在启动时读取一次，修改后需重启服务器
+void HttpResponse::InitErrorPages(const string& srcDir) {
+    for(const auto& page: CODE_PATH) {
+        string body;
+        int fd = open((srcDir + page.second).data(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if(fd >= 0 && fstat(fd, &st) == 0) {
+            body.resize(st.st_size);
+            if(read(fd, &body[0], body.size()) != static_cast<ssize_t>(body.size())) {
+                body.clear();
+            }
+        }
+        if(fd >= 0) { close(fd); }
+        if(body.empty()) {
+            LOG_WARN("Error page %s unavailable!", page.second.data());
+            body = ErrorBody_(page.first, "File NotFound!");
+        }
+        for(int i = 0; i < 2; i++) {
+            errorResponses_[i][page.first] = connHeaders_[i] + "Content-type: text/html\r\n"
+                                           + "Content-length: " + to_string(body.size()) + "\r\n\r\n" + body;
+        }
+    }
+}
+
+// 按Accept-Encoding选择编码版本：br只使用预压缩文件，gzip没有预压缩文件时即时压缩；都不可用时发送原文件
+void HttpResponse::SelectEncoding_() {
+    static const char* ENCODINGS[] = { "br", "gzip" };  // 按优先级排列，与AcceptEncoding_的位对应
+    int accept = AcceptEncoding_(acceptEncoding_);
+    for(int i = 0; i < 2; i++) {
+        if(!(accept & (1 << i))) { continue; }
+        FileEntryPtr encoded = FileCache::Instance()->GetEncoded(srcDir_ + path_, ENCODINGS[i], file_);
+        if(encoded) {
+            file_ = encoded;
+            return;
+        }
+    }
+}
+
+// 解析Accept-Encoding（RFC 7231）：第0位br，第1位gzip；q=0表示不可接受，"*"匹配未列出的编码
+int HttpResponse::AcceptEncoding_(const string& value) {
+    static const char* ENCODINGS[] = { "br", "gzip" };
+    int accept = 0, listed = 0;
+    bool star = false;
+    size_t pos = 0;
+    while(pos < value.size()) {
+        size_t comma = value.find(',', pos);
+        if(comma == string::npos) { comma = value.size(); }
+        size_t b = value.find_first_not_of(" \t", pos);
+        size_t semi = value.find(';', b);
+        size_t e = (semi == string::npos || semi > comma) ? comma : semi;
+        while(e > b && (value[e - 1] == ' ' || value[e - 1] == '\t')) { e--; }
+        double q = 1.0;
+        if(e < comma) {
+            size_t qpos = value.find("q=", e);
+            if(qpos != string::npos && qpos < comma) { q = strtod(value.c_str() + qpos + 2, nullptr); }
+        }
+        if(b != string::npos && b < e) {
+            if(e - b == 1 && value[b] == '*') {
+                star = q > 0;
+            }
+            for(int i = 0; i < 2; i++) {
+                if(strncasecmp(value.c_str() + b, ENCODINGS[i], e - b) == 0 && strlen(ENCODINGS[i]) == e - b) {
+                    listed |= 1 << i;
+                    if(q > 0) { accept |= 1 << i; }
+                }
+            }
+        }
+        pos = comma + 1;
+    }
+    if(star) { accept |= 3 & ~listed; }
+    return accept;
+}
+
+// 条件请求：有If-None-Match时只看ETag，否则看If-Modified-Since；只用缓存项中的元数据，不访问文件
+bool HttpResponse::NotModified_() const {
+    if(!ifNoneMatch_.empty()) {
+        return EtagMatch_(ifNoneMatch_, file_->etag);
+    }
+    time_t since;
+    if(!ifModifiedSince_.empty() && ParseHttpDate_(ifModifiedSince_, &since)) {
+        return file_->mtime <= since;
+    }
+    return false;
+}
+
+// If-Range：ETag用强比较，日期须与最后修改时间相同；不一致时忽略Range，返回完整文件
+bool HttpResponse::IfRange_() const {
+    if(ifRange_.empty()) { return true; }
+    if(ifRange_[0] == '"') { return ifRange_ == file_->etag; }
+    time_t date;
+    return ParseHttpDate_(ifRange_, &date) && date == file_->mtime;
+}
+
+// If-None-Match的ETag列表是否包含etag：弱比较，忽略W/前缀；"*"匹配任何存在的文件
+bool HttpResponse::EtagMatch_(const string& list, const string& etag) {
+    size_t pos = 0;
+    while(pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        if(comma == string::npos) { comma = list.size(); }
+        size_t b = list.find_first_not_of(" \t", pos);
+        size_t e = list.find_last_not_of(" \t", comma - 1);
+        if(b != string::npos && b < comma && e >= b) {
+            if(list.compare(b, 2, "W/") == 0) { b += 2; }
+            size_t len = e - b + 1;
+            if((len == 1 && list[b] == '*') || list.compare(b, len, etag) == 0) { return true; }
+        }
+        pos = comma + 1;
+    }
+    return false;
+}
+
+// 解析HTTP日期：只接受IMF-fixdate（RFC 7231），其他格式视为无效
+bool HttpResponse::ParseHttpDate_(const string& date, time_t* t) {
+    struct tm tm = { 0 };
+    const char* end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if(!end || *end != '\0') { return false; }
+    *t = timegm(&tm);
+    return *t != -1;
+}
+
+// 解析Range请求头（RFC 7233）：格式错误或区间过多时忽略Range，返回完整文件
+// 区间越过文件末尾时截断到末尾，起点不在文件内的区间不可满足；没有可满足的区间返回416
+int HttpResponse::ParseRange_() {
+    ranges_.clear();
+    const size_t size = file_->size;
+    const char* p = range_.c_str();
+    if(strncasecmp(p, "bytes=", 6) != 0) { return 200; }
+    p += 6;
+    size_t cnt = 0;
+    while(true) {
+        while(*p == ' ' || *p == '\t') { p++; }
+        bool hasFirst = false, hasLast = false;
+        size_t first = 0, last = 0;
+        // 数字过长时饱和，之后按越界处理
+        for(; *p >= '0' && *p <= '9'; p++, hasFirst = true) {
+            first = first > (SIZE_MAX - 9) / 10 ? SIZE_MAX : first * 10 + (*p - '0');
+        }
+        if(*p++ != '-') { return 200; }
+        for(; *p >= '0' && *p <= '9'; p++, hasLast = true) {
+            last = last > (SIZE_MAX - 9) / 10 ? SIZE_MAX : last * 10 + (*p - '0');
+        }
+        if(!hasFirst && !hasLast) { return 200; }
+        if(hasFirst && hasLast && first > last) { return 200; }
+        if(++cnt > MAX_RANGES) { return 200; }
+        if(!hasFirst) {
+            // 后缀区间：最后last个字节
+            if(last > 0 && size > 0) {
+                size_t len = last < size ? last : size;
+                ranges_.push_back({ static_cast<off_t>(size - len), len });
+            }
+        } else if(first < size) {
+            size_t end = (hasLast && last < size - 1) ? last : size - 1;
+            ranges_.push_back({ static_cast<off_t>(first), end - first + 1 });
+        }
+        while(*p == ' ' || *p == '\t') { p++; }
+        if(*p == '\0') { break; }
+        if(*p++ != ',') { return 200; }
+    }
+    return ranges_.empty() ? 416 : 206;
+}
+
+// 添加206响应：一个区间时直接发送该区间；多个区间时按multipart/byteranges逐段发送，
+// 每段的分隔行与段头部追加到写缓冲区，段内容仍从文件发送
+void HttpResponse::AddRangeContent_(Buffer& buff, size_t begin) {
+    const string total = "/" + to_string(file_->size);
+    if(ranges_.size() == 1) {
+        size_t first = ranges_[0].first, len = ranges_[0].second;
+        AddHeader_(buff, file_->type);
+        buff.Append(file_->entityHeaders);
+        buff.Append("Content-Range: bytes " + to_string(first) + "-" + to_string(first + len - 1) + total + "\r\n");
+        buff.Append("Content-length: " + to_string(len) + "\r\n\r\n");
+        slices_.push_back({ buff.ReadableBytes() - begin, ranges_[0].first, len });
+        return;
+    }
+    vector<string> parts;
+    const string tail = "\r\n--" + BOUNDARY + "--\r\n";
+    size_t bodyLen = tail.size();
+    for(const auto& range: ranges_) {
+        size_t first = range.first, len = range.second;
+        parts.push_back("\r\n--" + BOUNDARY + "\r\nContent-type: " + file_->type + "\r\n"
+                        + "Content-Range: bytes " + to_string(first) + "-" + to_string(first + len - 1) + total
+                        + "\r\n\r\n");
+        bodyLen += parts.back().size() + len;
+    }
+    AddHeader_(buff, "multipart/byteranges; boundary=" + BOUNDARY);
+    buff.Append(file_->entityHeaders);
+    buff.Append("Content-length: " + to_string(bodyLen) + "\r\n\r\n");
+    size_t mark = begin;
+    for(size_t i = 0; i < ranges_.size(); i++) {
+        buff.Append(parts[i]);
+        slices_.push_back({ buff.ReadableBytes() - mark, ranges_[i].first, ranges_[i].second });
+        mark = buff.ReadableBytes();
+    }
+    buff.Append(tail);
+    slices_.push_back({ buff.ReadableBytes() - mark, 0, 0 });
 }
 
 // 返回映射的文件
 char* HttpResponse::File() {
-    return mmFile_;
+    return file_ ? file_->data : nullptr;
 }
 
 // 返回文件长度信息
 size_t HttpResponse::FileLen() const {
-    return mmFileStat_.st_size;
-}
-
-// 错误网页路径：判断路径是否在给定的响应状态码对应的路径中
-void HttpResponse::ErrorHtml_() {
-    if(CODE_PATH.count(code_) == 1) {
-        path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
-    }
+    return file_ ? file_->size : 0;
 }
 
 // 添加响应行
 void HttpResponse::AddStateLine_(Buffer& buff) {
-    string status;
-    if(CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    }
-    else {
+    auto line = STATUS_LINE.find(code_);
+    if(line == STATUS_LINE.end()) {
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
+        line = STATUS_LINE.find(400);
     }
     // 协议版本 + 状态码 + 状态码描述 + 换行
-    buff.Append("HTTP/1.1 " + to_string(code_) + " " + status + "\r\n");
+    buff.Append(line->second);
 }
 
-// 添加响应头
-void HttpResponse::AddHeader_(Buffer& buff) {
-    buff.Append("Connection: ");
-    if(isKeepAlive_) {
-        buff.Append("keep-alive\r\n");
-        buff.Append("keep-alive: max=6, timeout=120\r\n");
-    } else{
-        buff.Append("close\r\n");
-    }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+// 添加Date响应头：粗粒度时钟提供格式化好的一行，每秒只格式化一次
+void HttpResponse::AddDate_(Buffer& buff) {
+    buff.Append(CoarseClock::DateLine());
 }
 
-// 添加响应体
-void HttpResponse::AddContent_(Buffer& buff) {
-    // open打开对应的资源，获取文件描述符
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
-    // 如果打开文件失败，就追加一个错误信息返回
-    if(srcFd < 0) { 
-        ErrorContent(buff, "File NotFound!");
-        return; 
+// 添加Keep-Alive响应头：max为本连接剩余的请求数，每个响应都不同，不能放进预先生成的响应头
+void HttpResponse::AddKeepAlive_(Buffer& buff) {
+    if(!isKeepAlive_ || (keepAliveTimeout_.empty() && keepAliveLeft_ <= 0)) {
+        return;
     }
-    // 如果文件正常打开，就进行内存映射
-    // 将文件映射到内存以提高文件的访问速度 MAP_PRIVATE 建立一个写入时拷贝的私有映射
-    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if(*mmRet == -1) {
-        ErrorContent(buff, "File NotFound!");
-        return; 
+    char line[64];
+    int len;
+    if(keepAliveLeft_ <= 0) {
+        len = snprintf(line, sizeof(line), "Keep-Alive: %s\r\n", keepAliveTimeout_.c_str());
+    } else if(keepAliveTimeout_.empty()) {
+        len = snprintf(line, sizeof(line), "Keep-Alive: max=%d\r\n", keepAliveLeft_);
+    } else {
+        len = snprintf(line, sizeof(line), "Keep-Alive: %s, max=%d\r\n", keepAliveTimeout_.c_str(), keepAliveLeft_);
     }
-    mmFile_ = (char*)mmRet;// 使用mmap映射到内存并返回映射指针给mmFile
-    close(srcFd);
-    // 响应体长度信息
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    buff.Append(line, len);
 }
 
-// 解除内存映射
-void HttpResponse::UnmapFile() {
-    if(mmFile_) {
-        munmap(mmFile_, mmFileStat_.st_size);// munmap调用
-        mmFile_ = nullptr;// 内存映射指针置为空
-    }
+// 添加响应头：文件打开失败与206响应时使用，其余有文件时使用缓存项中生成好的响应头
+void HttpResponse::AddHeader_(Buffer& buff, const string& type) {
+    buff.Append(connHeaders_[isKeepAlive_]);
+    buff.Append("Content-type: " + type + "\r\n");
 }
 
-// 获取文件类型
-string HttpResponse::GetFileType_() {
-    // 判断文件类型，然后去对应的文件后缀后面查找
-    string::size_type idx = path_.find_last_of('.');
-    if(idx == string::npos) {
-        return "text/plain";
+// 添加错误响应：使用启动时生成好的响应，没有时（未调用InitErrorPages）现场生成错误信息网页
+void HttpResponse::AddErrorContent_(Buffer& buff) {
+    const auto& responses = errorResponses_[isKeepAlive_];
+    auto it = responses.find(code_);
+    if(it != responses.end()) {
+        buff.Append(it->second);
+        return;
     }
-    string suffix = path_.substr(idx);
-    if(SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
-    }
-    return "text/plain";
+    AddHeader_(buff, "text/html");
+    ErrorContent(buff, "File NotFound!");
+}
+
+// 释放借用的文件缓存项：缓存项已被淘汰时由最后一个引用关闭文件
+void HttpResponse::ReleaseFile() {
+    file_.reset();
 }
 
 // 追加打开文件资源失败的错误信息并返回
 void HttpResponse::ErrorContent(Buffer& buff, string message) 
 {
+    string body = ErrorBody_(code_, message);
+    buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
+    buff.Append(body);
+}
+
+// 错误信息网页
+string HttpResponse::ErrorBody_(int code, const string& message) {
     string body;
     string status;
     body += "<html><title>Error</title>";
     body += "<body bgcolor=\"ffffff\">";
-    if(CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
+    if(CODE_STATUS.count(code) == 1) {
+        status = CODE_STATUS.find(code)->second;
     } else {
         status = "Bad Request";
     }
-    body += to_string(code_) + " : " + status  + "\n";
+    body += to_string(code) + " : " + status  + "\n";
     body += "<p>" + message + "</p>";
     body += "<hr><em>TinyWebServer</em></body></html>";
-
-    buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
-    buff.Append(body);
+    return body;
 }
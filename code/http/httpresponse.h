@@ -2,55 +2,102 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
-#include <fcntl.h>       // open
-#include <unistd.h>      // close
-#include <sys/stat.h>    // stat
-#include <sys/mman.h>    // mmap, munmap
+#include <vector>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "filecache.h"
+#include "httprequest.h"
 
 // HTTP响应类 将响应封装成HttpResponse对象
 class HttpResponse {
 public:
+    // 响应的一段：先发送写缓冲区中的textLen字节，再发送文件的[offset, offset + len)
+    // 普通响应只有一段；多段Range响应每段前是该段的分隔行与段头部，最后一段只有结束分隔行
+    struct Slice {
+        size_t textLen;
+        off_t offset;
+        size_t len;
+    };
+
     HttpResponse();
     ~HttpResponse();
 
-    // HTTP响应初始化
-    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
+    // HTTP响应初始化：keepAliveLeft为本响应之后连接还能处理的请求数，由Keep-Alive响应头的max通告，0为不限制
+    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1,
+              int keepAliveLeft = 0);
+    // 记录与GET请求相关的请求头：条件请求（If-None-Match、If-Modified-Since）、Range、If-Range与Accept-Encoding
+    void SetRequest(const HttpRequest& request);
      // 创建响应
     void MakeResponse(Buffer& buff);
-    // 解除内存映射
-    void UnmapFile();
+    // 响应的各段，MakeResponse之后有效
+    const std::vector<Slice>& Slices() const { return slices_; }
+    // 释放借用的文件缓存项
+    void ReleaseFile();
     // 返回映射的文件
     char* File();
+    // 返回sendfile模式下打开的文件，没有时为-1
+    int FileFd() const { return file_ ? file_->fd : -1; }
     // 返回文件长度信息
     size_t FileLen() const;
     // 追加打开文件资源失败的错误信息并返回
     void ErrorContent(Buffer& buff, std::string message);
+    // 启动时把错误页读入内存，生成完整的错误响应
+    static void InitErrorPages(const std::string& srcDir);
+    // 设置Keep-Alive响应头通告的空闲超时（0为不限时，不通告）
+    static void InitKeepAlive(int timeoutMS);
+    // Connection响应头：[0]关闭连接，[1]保持连接；Keep-Alive响应头按连接剩余的请求数逐个响应生成
+    static const std::string& ConnHeader(bool keepAlive) { return connHeaders_[keepAlive]; }
     // 返回响应状态码
     int Code() const { return code_; }
 
+    static bool useSendfile;  // 是否用sendfile发送文件：缓存中只保留文件描述符，不做内存映射
+    // 响应是否保持连接
+    bool IsKeepAlive() const { return isKeepAlive_; }
+
 private:
     void AddStateLine_(Buffer &buff);// 添加响应行
-    void AddHeader_(Buffer &buff); // 添加响应头
-    void AddContent_(Buffer &buff);// 添加响应体
-
-    void ErrorHtml_(); // 错误网页路径：判断路径是否在给定的响应状态码对应的路径中
-    std::string GetFileType_();// 获取文件类型
+    void AddDate_(Buffer &buff);// 添加Date响应头
+    void AddKeepAlive_(Buffer &buff);// 添加Keep-Alive响应头
+    void AddHeader_(Buffer &buff, const std::string& type); // 添加响应头
+    void AddErrorContent_(Buffer &buff);// 添加错误响应的响应头与错误页
+    void SelectEncoding_();// 按Accept-Encoding选择文件的编码版本
+    static int AcceptEncoding_(const std::string& value);// 解析Accept-Encoding：返回可接受编码的位图
+    bool NotModified_() const;// 条件请求：缓存的文件未修改时返回true
+    bool IfRange_() const;// If-Range与当前文件一致（或没有If-Range）时返回true
+    int ParseRange_();// 解析Range：返回200（忽略Range）、206或416
+    static bool EtagMatch_(const std::string& list, const std::string& etag);// If-None-Match的ETag列表是否包含etag（弱比较）
+    static bool ParseHttpDate_(const std::string& date, time_t* t);// 解析HTTP日期（IMF-fixdate）
+    void AddRangeContent_(Buffer &buff, size_t begin);// 添加206响应的头部与各段
+    static std::string ErrorBody_(int code, const std::string& message);// 错误页不可用时的错误信息网页
 
     int code_;  // 响应状态码
     bool isKeepAlive_;  // 是否保持连接 
+    int keepAliveLeft_;  // 本响应之后连接还能处理的请求数，0为不限制
 
     std::string path_;  // 资源的路径
     std::string srcDir_;  // 资源的目录
     
-    char* mmFile_;  // 文件内存映射指针
-    struct stat mmFileStat_;  // 文件的状态信息
+    FileEntryPtr file_;  // 从文件缓存借用的文件：映射、文件描述符与元数据
+
+    std::string range_;  // Range请求头，没有时为空
+    std::string ifRange_;  // If-Range请求头
+    std::string ifNoneMatch_;  // If-None-Match请求头
+    std::string ifModifiedSince_;  // If-Modified-Since请求头
+    std::string acceptEncoding_;  // Accept-Encoding请求头
+    std::vector<std::pair<off_t, size_t>> ranges_;  // 可满足的区间：起始偏移、长度
+    std::vector<Slice> slices_;  // 响应的各段
+
+    static const size_t MAX_RANGES = 16;  // 一个请求最多的区间数，超过时忽略Range
+    static const std::string BOUNDARY;  // 多段响应的分隔符
 
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;  // 后缀-类型
     static const std::unordered_map<int, std::string> CODE_STATUS;  // 状态码-描述
+    static const std::unordered_map<int, std::string> STATUS_LINE;  // 状态码-完整的响应行
     static const std::unordered_map<int, std::string> CODE_PATH;  // 状态码-路径
+    // 预先生成的错误响应：Date之后的全部内容（响应头与错误页），[0]不保持连接，[1]保持连接
+    static std::unordered_map<int, std::string> errorResponses_[2];
+    static const std::string connHeaders_[2];  // Connection响应头
+    static std::string keepAliveTimeout_;  // Keep-Alive响应头中的timeout参数，不通告时为空
 };
 
 
@@ -0,0 +1,176 @@
+#include "httpscan.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_SCAN_X86 1
+#endif
+
+namespace {
+
+// 字符类：accept为标量查表；lo、hi为按低4位、高4位查表的位图，两者相与非零表示属于该类
+// 0x80以上的字节高4位表项为0，是否属于该类由high单独决定
+struct CharClass {
+    bool accept[256];
+    alignas(16) uint8_t lo[16];
+    alignas(16) uint8_t hi[16];
+    bool high;
+};
+
+CharClass MakeClass_(bool (*pred)(unsigned char)) {
+    CharClass c;
+    memset(&c, 0, sizeof(c));
+    for(int b = 0; b < 256; b++) {
+        c.accept[b] = pred(static_cast<unsigned char>(b));
+        if(b < 0x80 && c.accept[b]) {
+            c.lo[b & 0x0f] |= static_cast<uint8_t>(1 << (b >> 4));
+        }
+    }
+    for(int h = 0; h < 8; h++) {
+        c.hi[h] = static_cast<uint8_t>(1 << h);
+    }
+    c.high = pred(0x80);
+    return c;
+}
+
+// RFC 7230 tchar
+bool IsToken_(unsigned char ch) {
+    if((ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z')) { return true; }
+    return ch != 0 && strchr("!#$%&'*+-.^_`|~", ch) != nullptr;
+}
+
+bool IsUri_(unsigned char ch) { return ch > 0x20 && ch != 0x7f; }
+
+bool IsText_(unsigned char ch) { return ch == '\t' || (ch >= 0x20 && ch != 0x7f); }
+
+const CharClass TOKEN = MakeClass_(IsToken_);
+const CharClass URI = MakeClass_(IsUri_);
+const CharClass TEXT = MakeClass_(IsText_);
+
+// 以下实现均返回[p, end)中第一个不属于字符类c的位置，全部属于时返回end
+const char* ScanScalar_(const char* p, const char* end, const CharClass& c) {
+    while(p < end && c.accept[static_cast<unsigned char>(*p)]) { p++; }
+    return p;
+}
+
+#ifdef HTTP_SCAN_X86
+// 一块16字节中不属于字符类的字节位图
+__attribute__((target("sse4.2")))
+inline unsigned Classify16_(const char* p, const CharClass& c) {
+    const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(c.lo));
+    const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(c.hi));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i high = c.high ? _mm_set1_epi8(-1) : zero;
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(v, nibble));
+    __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    __m128i out = _mm_cmpeq_epi8(_mm_and_si128(l, h), zero);
+    out = _mm_andnot_si128(_mm_and_si128(_mm_cmplt_epi8(v, zero), high), out);
+    return static_cast<unsigned>(_mm_movemask_epi8(out));
+}
+
+// AVX2按字符类分类：返回一块32字节中不属于该类的字节，对应字节为0xff
+struct Classifier32 {
+    __m256i lo, hi, nibble, zero, high;
+
+    __attribute__((target("avx2")))
+    explicit Classifier32(const CharClass& c) {
+        lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(c.lo)));
+        hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(c.hi)));
+        nibble = _mm256_set1_epi8(0x0f);
+        zero = _mm256_setzero_si256();
+        high = c.high ? _mm256_set1_epi8(-1) : zero;
+    }
+
+    __attribute__((target("avx2")))
+    __m256i operator()(const char* p) const {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        __m256i out = _mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero);
+        return _mm256_andnot_si256(_mm256_and_si256(_mm256_cmpgt_epi8(zero, v), high), out);
+    }
+};
+
+__attribute__((target("sse4.2")))
+const char* ScanSse42_(const char* p, const char* end, const CharClass& c) {
+    for(; end - p >= 16; p += 16) {
+        unsigned mask = Classify16_(p, c);
+        if(mask) { return p + __builtin_ctz(mask); }
+    }
+    // 不足16字节的尾部复制到栈上再分类，不读取end之后的内存
+    if(p < end) {
+        char tail[16] = {0};
+        memcpy(tail, p, end - p);
+        unsigned mask = Classify16_(tail, c) & ((1u << (end - p)) - 1);
+        return mask ? p + __builtin_ctz(mask) : end;
+    }
+    return p;
+}
+
+// 长数据（Cookie、User-Agent）每轮处理128字节，只在四块合并后有命中时才逐块定位
+__attribute__((target("avx2")))
+const char* ScanAvx2_(const char* p, const char* end, const CharClass& c) {
+    const Classifier32 classify(c);
+    for(; end - p >= 128; p += 128) {
+        __m256i o0 = classify(p), o1 = classify(p + 32), o2 = classify(p + 64), o3 = classify(p + 96);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(o0, o1), _mm256_or_si256(o2, o3));
+        if(!_mm256_testz_si256(any, any)) {
+            uint64_t lowMask = static_cast<uint32_t>(_mm256_movemask_epi8(o0))
+                | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(o1))) << 32;
+            if(lowMask) { return p + __builtin_ctzll(lowMask); }
+            uint64_t highMask = static_cast<uint32_t>(_mm256_movemask_epi8(o2))
+                | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(o3))) << 32;
+            return p + 64 + __builtin_ctzll(highMask);
+        }
+    }
+    for(; end - p >= 32; p += 32) {
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(classify(p)));
+        if(mask) { return p + __builtin_ctz(mask); }
+    }
+    if(p < end) {
+        char tail[32] = {0};
+        memcpy(tail, p, end - p);
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(classify(tail))) & ((1ull << (end - p)) - 1);
+        return mask ? p + __builtin_ctz(mask) : end;
+    }
+    return p;
+}
+#endif
+
+typedef const char* (*ScanFn)(const char*, const char*, const CharClass&);
+
+struct ScanImpl {
+    ScanFn fn;
+    const char* name;
+};
+
+ScanImpl SelectImpl_() {
+#ifdef HTTP_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) { return { ScanAvx2_, "avx2" }; }
+    if(__builtin_cpu_supports("sse4.2")) { return { ScanSse42_, "sse4.2" }; }
+#endif
+    return { ScanScalar_, "scalar" };
+}
+
+const ScanImpl IMPL = SelectImpl_();
+
+} // namespace
+
+const char* HttpScan::SkipToken(const char* begin, const char* end) {
+    return IMPL.fn(begin, end, TOKEN);
+}
+
+const char* HttpScan::SkipUri(const char* begin, const char* end) {
+    return IMPL.fn(begin, end, URI);
+}
+
+const char* HttpScan::SkipText(const char* begin, const char* end) {
+    return IMPL.fn(begin, end, TEXT);
+}
+
+const char* HttpScan::Isa() {
+    return IMPL.name;
+}
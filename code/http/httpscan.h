@@ -0,0 +1,20 @@
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+#include <stdint.h>
+
+// HTTP报文字符扫描：按字符类一次跳过一段字节，同时完成分隔符查找与字符合法性校验
+// 提供AVX2（32字节）、SSE4.2（16字节）和标量三种实现，程序启动时按CPUID选择
+class HttpScan {
+public:
+    // 跳过token字符（方法名、请求头名称、版本号），返回第一个非token字符的位置
+    static const char* SkipToken(const char* begin, const char* end);
+    // 跳过请求路径字符（空格与控制字符以外），返回第一个空格或控制字符的位置
+    static const char* SkipUri(const char* begin, const char* end);
+    // 跳过请求头值字符（可见字符、空格、\t和0x80以上字节），返回第一个控制字符的位置，通常是\r
+    static const char* SkipText(const char* begin, const char* end);
+    // 当前使用的实现："avx2"、"sse4.2"或"scalar"
+    static const char* Isa();
+};
+
+#endif //HTTP_SCAN_H
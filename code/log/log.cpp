@@ -1,57 +1,70 @@
 #include "log.h"
+#include <algorithm>
+#include <fcntl.h>       // open
+#include <unistd.h>      // write, close
+#include <sys/uio.h>     // writev
 
 using namespace std;
 
+namespace {
+
+// 线程持有的环形缓冲区：线程退出时标记关闭，缓冲区本身由写日志线程写完后释放
+struct RingHolder {
+    shared_ptr<LogRing> ring;
+    ~RingHolder() { if(ring) { ring->Close(); } }
+};
+
+RingHolder& LocalHolder_() {
+    static thread_local RingHolder holder;
+    return holder;
+}
+
+int OpenLogFile_(const char* fileName) {
+    return open(fileName, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+}
+
+} // namespace
+
+const int Log::BATCH_DELAY_MS;  // 以引用方式传给chrono::milliseconds，需要定义
+
 Log::Log() {
     lineCount_ = 0;
+    isOpen_ = false;
+    level_ = 1;
     isAsync_ = false;
+    ringCapacity_ = 0;
+    isClose_ = false;
     writeThread_ = nullptr;
-    deque_ = nullptr;
     toDay_ = 0;
-    fp_ = nullptr;
+    fd_ = -1;
 }
 
 Log::~Log() {
     if(writeThread_ && writeThread_->joinable()) {
-        while(!deque_->empty()) {
-            deque_->flush();
-        };
-        deque_->Close();
+        // 写日志线程写完所有缓冲区后退出
+        isClose_ = true;
+        wake_.NotifyAll();
         writeThread_->join();
     }
-    if(fp_) {
-        lock_guard<mutex> locker(mtx_);
-        flush();
-        fclose(fp_);
+    if(fd_ >= 0) {
+        close(fd_);
     }
 }
 
 int Log::GetLevel() {
-    lock_guard<mutex> locker(mtx_);
-    return level_;
+    return level_.load(memory_order_relaxed);
 }
 
 void Log::SetLevel(int level) {
-    lock_guard<mutex> locker(mtx_);
-    level_ = level;
+    level_.store(level, memory_order_relaxed);
 }
 
 void Log::init(int level = 1, const char* path, const char* suffix,
     int maxQueueSize) {
     isOpen_ = true;
     level_ = level;
-    if(maxQueueSize > 0) {
-        isAsync_ = true;
-        if(!deque_) {
-            unique_ptr<BlockDeque<std::string>> newDeque(new BlockDeque<std::string>);
-            deque_ = move(newDeque);
-            
-            std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
-            writeThread_ = move(NewThread);
-        }
-    } else {
-        isAsync_ = false;
-    }
+    isAsync_ = maxQueueSize > 0;
+    ringCapacity_ = isAsync_ ? static_cast<size_t>(maxQueueSize) * AVG_LINE_LEN : 0;
 
     lineCount_ = 0;
 
@@ -61,120 +74,248 @@ void Log::init(int level = 1, const char* path, const char* suffix,
     path_ = path;
     suffix_ = suffix;
     char fileName[LOG_NAME_LEN] = {0};
-    snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s", 
+    snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s",
             path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
     toDay_ = t.tm_mday;
 
     {
         lock_guard<mutex> locker(mtx_);
-        buff_.RetrieveAll();
-        if(fp_) { 
-            flush();
-            fclose(fp_); 
+        if(fd_ >= 0) {
+            close(fd_);
         }
 
-        fp_ = fopen(fileName, "a");
-        if(fp_ == nullptr) {
+        fd_ = OpenLogFile_(fileName);
+        if(fd_ < 0) {
             mkdir(path_, 0777);
-            fp_ = fopen(fileName, "a");
-        } 
-        assert(fp_ != nullptr);
+            fd_ = OpenLogFile_(fileName);
+        }
+        assert(fd_ >= 0);
+    }
+
+    if(isAsync_ && !writeThread_) {
+        std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
+        writeThread_ = move(NewThread);
     }
 }
 
 void Log::write(int level, const char *format, ...) {
-    struct timeval now = {0, 0};
-    gettimeofday(&now, nullptr);
-    time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
+    // 在栈上格式化：时间取自粗粒度时钟，每秒只转换、格式化一次秒及以上的部分
+    // 写日志的线程不一定在事件循环中，直接读取时钟，服务器空闲时时间戳也是准确的
+    char line[LogRing::MAX_LINE_LEN];
+    int64_t us = CoarseClock::ReadRealUs();
+    int n = CoarseClock::LogTimestamp(line, us);
+    n += AppendLogLevelTitle_(level, line + n);
+
     va_list vaList;
+    va_start(vaList, format);
+    int avail = static_cast<int>(sizeof(line)) - n - 1;  // 留一个字节给换行
+    int m = vsnprintf(line + n, avail, format, vaList);
+    va_end(vaList);
 
-    /* 日志日期 日志行数 */
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_  %  MAX_LINES == 0)))
-    {
-        unique_lock<mutex> locker(mtx_);
-        locker.unlock();
-        
-        char newFile[LOG_NAME_LEN];
-        char tail[36] = {0};
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
-
-        if (toDay_ != t.tm_mday)
-        {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            toDay_ = t.tm_mday;
-            lineCount_ = 0;
+    n += max(0, min(m, avail - 1));  // 过长的行截断
+    line[n++] = '\n';
+
+    if(isAsync_ && !isClose_.load(memory_order_relaxed)) {
+        // 写入当前线程的环形缓冲区，不加锁；缓冲区满时唤醒写日志线程并让出CPU
+        LogRing* ring = LocalRing_();
+        while(!ring->Push(us, line, n)) {
+            if(isClose_.load(memory_order_relaxed)) { break; }
+            wake_.NotifyOne();
+            this_thread::yield();
         }
-        else {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_  / MAX_LINES), suffix_);
+        if(!isClose_.load(memory_order_relaxed)) {
+            Wake_();
+            return;
         }
-        
-        locker.lock();
-        flush();
-        fclose(fp_);
-        fp_ = fopen(newFile, "a");
-        assert(fp_ != nullptr);
     }
 
-    {
-        unique_lock<mutex> locker(mtx_);
-        lineCount_++;
-        int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                    t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                    t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-                    
-        buff_.HasWritten(n);
-        AppendLogLevelTitle_(level);
-
-        va_start(vaList, format);
-        int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
-        va_end(vaList);
-
-        buff_.HasWritten(m);
-        buff_.Append("\n\0", 2);
-
-        if(isAsync_ && deque_ && !deque_->full()) {
-            deque_->push_back(buff_.RetrieveAllToStr());
-        } else {
-            fputs(buff_.Peek(), fp_);
-        }
-        buff_.RetrieveAll();
+    // 同步模式：加锁直接写入文件
+    lock_guard<mutex> locker(mtx_);
+    const struct tm& t = CoarseClock::LocalTime(static_cast<time_t>(us / 1000000));
+    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_  %  MAX_LINES == 0))) {
+        Rotate_(t);
     }
+    lineCount_++;
+    struct iovec iov = { line, static_cast<size_t>(n) };
+    WriteAll_(&iov, 1);
 }
 
-void Log::AppendLogLevelTitle_(int level) {
+int Log::AppendLogLevelTitle_(int level, char* buf) {
     switch(level) {
     case 0:
-        buff_.Append("[debug]: ", 9);
+        memcpy(buf, "[debug]: ", 9);
         break;
     case 1:
-        buff_.Append("[info] : ", 9);
+        memcpy(buf, "[info] : ", 9);
         break;
     case 2:
-        buff_.Append("[warn] : ", 9);
+        memcpy(buf, "[warn] : ", 9);
         break;
     case 3:
-        buff_.Append("[error]: ", 9);
+        memcpy(buf, "[error]: ", 9);
         break;
     default:
-        buff_.Append("[info] : ", 9);
+        memcpy(buf, "[info] : ", 9);
         break;
     }
+    return 9;
 }
 
+// 日志直接写入文件描述符，没有需要刷新的用户态缓冲；异步模式下唤醒休眠的写日志线程
 void Log::flush() {
-    if(isAsync_) { 
-        deque_->flush(); 
+    if(isAsync_) {
+        Wake_();
     }
-    fflush(fp_);
 }
 
-void Log::AsyncWrite_() {
-    string str = "";
-    while(deque_->pop(str)) {
+void Log::Wake_() {
+    // 与写日志线程登记等待后的再次检查配对：要么这里看到等待者，要么写日志线程看到新写入的行
+    atomic_thread_fence(memory_order_seq_cst);
+    if(wake_.HasWaiters()) {
+        wake_.NotifyOne();
+    }
+}
+
+LogRing* Log::LocalRing_() {
+    RingHolder& holder = LocalHolder_();
+    if(!holder.ring) {
+        holder.ring = make_shared<LogRing>(ringCapacity_);
+        lock_guard<mutex> locker(ringsMtx_);
+        rings_.push_back(holder.ring);
+    }
+    return holder.ring.get();
+}
+
+void Log::Rotate_(const struct tm& t) {
+    char newFile[LOG_NAME_LEN];
+    char tail[36] = {0};
+    snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+
+    if (toDay_ != t.tm_mday)
+    {
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
+        toDay_ = t.tm_mday;
+        lineCount_ = 0;
+    }
+    else {
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_  / MAX_LINES), suffix_);
+    }
+
+    close(fd_);
+    fd_ = OpenLogFile_(newFile);
+    assert(fd_ >= 0);
+}
+
+void Log::WriteAll_(struct iovec* iov, int cnt) {
+    while(cnt > 0) {
+        ssize_t len = writev(fd_, iov, cnt);
+        if(len < 0) {
+            if(errno == EINTR) { continue; }
+            return;
+        }
+        // 部分写入：跳过已写完的行
+        while(cnt > 0 && static_cast<size_t>(len) >= iov->iov_len) {
+            len -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if(cnt > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + len;
+            iov->iov_len -= len;
+        }
+    }
+}
+
+// 合并写入：各缓冲区内的行已按时间排列，每次取队首时间戳最小的一行，凑满一批后一次writev
+// 写入后才释放缓冲区的空间，日志行不再复制
+size_t Log::WriteBatch_(vector<shared_ptr<LogRing>>& rings) {
+    size_t k = rings.size();
+    vector<LogRing::Cursor> cursors(k);
+    vector<const char*> heads(k);
+    vector<int64_t> stamps(k);
+    vector<size_t> lens(k);
+    for(size_t i = 0; i < k; i++) {
+        rings[i]->Snapshot(&cursors[i]);
+        heads[i] = rings[i]->Peek(&cursors[i], &stamps[i], &lens[i]);
+    }
+
+    // 日期变化：先切换文件，本批的行计入新文件；写日志线程不在事件循环中，直接读取时钟
+    const struct tm& t = CoarseClock::LocalTime(static_cast<time_t>(CoarseClock::ReadRealUs() / 1000000));
+    if(toDay_ != t.tm_mday) {
         lock_guard<mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+        Rotate_(t);
+    }
+
+    struct iovec iov[MAX_BATCH];
+    int cnt = 0;
+    bool rotate = false;
+    while(cnt < MAX_BATCH && !rotate) {
+        int best = -1;
+        for(size_t i = 0; i < k; i++) {
+            if(heads[i] && (best < 0 || stamps[i] < stamps[best])) {
+                best = static_cast<int>(i);
+            }
+        }
+        if(best < 0) { break; }
+        iov[cnt].iov_base = const_cast<char*>(heads[best]);
+        iov[cnt].iov_len = lens[best];
+        cnt++;
+        rings[best]->Pop(&cursors[best]);
+        heads[best] = rings[best]->Peek(&cursors[best], &stamps[best], &lens[best]);
+        lineCount_++;
+        rotate = (lineCount_ % MAX_LINES == 0);  // 写完这一批后切换文件
+    }
+    if(cnt == 0) { return 0; }
+
+    {
+        lock_guard<mutex> locker(mtx_);
+        WriteAll_(iov, cnt);
+        if(rotate) {
+            Rotate_(t);
+        }
+    }
+    for(size_t i = 0; i < k; i++) {
+        rings[i]->Release(cursors[i]);
+    }
+    return cnt;
+}
+
+void Log::AsyncWrite_() {
+    vector<shared_ptr<LogRing>> rings;
+    while(true) {
+        {
+            // 所属线程已退出且已写完的缓冲区移除
+            lock_guard<mutex> locker(ringsMtx_);
+            rings_.erase(remove_if(rings_.begin(), rings_.end(),
+                                   [](const shared_ptr<LogRing>& r) { return r->IsClosed() && r->Empty(); }),
+                         rings_.end());
+            rings = rings_;
+        }
+        size_t written = WriteBatch_(rings);
+        if(written > 0) {
+            // 不满一批：先不登记等待，小睡一会儿再写，期间生产者不用唤醒，日志行攒成较大的批
+            if(written < MAX_BATCH && !isClose_.load()) {
+                this_thread::sleep_for(chrono::milliseconds(BATCH_DELAY_MS));
+            }
+            continue;
+        }
+
+        // 没有日志可写：登记等待后再检查一次所有缓冲区（包括刚登记的线程），避免错过唤醒
+        uint32_t key = wake_.PrepareWait();
+        atomic_thread_fence(memory_order_seq_cst);
+        bool empty = true;
+        {
+            lock_guard<mutex> locker(ringsMtx_);
+            for(const auto& r : rings_) {
+                if(!r->Empty()) { empty = false; break; }
+            }
+        }
+        if(!empty || isClose_.load()) {
+            wake_.CancelWait();
+            if(empty) { break; }
+            continue;
+        }
+        wake_.Wait(key);
     }
 }
 
@@ -185,4 +326,4 @@ Log* Log::Instance() {
 
 void Log::FlushLogThread() {
     Log::Instance()->AsyncWrite_();
-}
\ No newline at end of file
+}
@@ -4,18 +4,23 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+#include <atomic>
 #include <sys/time.h>
 #include <string.h>
 #include <stdarg.h>           // vastart va_end
 #include <assert.h>
 #include <sys/stat.h>         //mkdir
-#include "blockqueue.h"
-#include "../buffer/buffer.h"
+#include "logring.h"
+#include "../pool/mpmcqueue.h"
+#include "../timer/coarseclock.h"
 
+// 日志系统：异步模式下每个线程把日志行写入自己的环形缓冲区，不加锁；
+// 写日志线程按时间戳合并各线程的日志行，一次writev写入一批
 class Log {
 public:
-    // 日志初始化
-    void init(int level, const char* path = "./log", 
+    // 日志初始化：maxQueueCapacity为异步模式下每个线程的环形缓冲区可容纳的行数（按每行128字节估计），0为同步写入
+    void init(int level, const char* path = "./log",
                 const char* suffix =".log",
                 int maxQueueCapacity = 1024);
     // 实例化一个对象
@@ -28,37 +33,48 @@ public:
     int GetLevel();
     void SetLevel(int level);
     bool IsOpen() { return isOpen_; }
-    
+
 private:
     // 单例模式：私有化构造和析构
     Log();
-    void AppendLogLevelTitle_(int level);
+    static int AppendLogLevelTitle_(int level, char* buf);
     virtual ~Log();
     void AsyncWrite_();
+    LogRing* LocalRing_();  // 当前线程的环形缓冲区：第一次写日志时创建并登记
+    size_t WriteBatch_(std::vector<std::shared_ptr<LogRing>>& rings);  // 合并写入一批日志行，返回行数
+    void WriteAll_(struct iovec* iov, int cnt);  // 写入文件：处理部分写入
+    void Rotate_(const struct tm& t);  // 按日期、行数切换日志文件
+    void Wake_();  // 写日志线程休眠时唤醒
 
 private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
     static const int MAX_LINES = 50000;
+    static const int AVG_LINE_LEN = 128;  // 估计环形缓冲区容量时每行的长度
+    static const int MAX_BATCH = 1024;  // 一次writev的最大行数（IOV_MAX）
+    static const int BATCH_DELAY_MS = 1;  // 写完不满一批时，等待下一批的时间
 
     const char* path_;
     const char* suffix_;
 
     int MAX_LINES_;
 
-    int lineCount_;
+    int lineCount_;  // 异步模式下只由写日志线程访问
     int toDay_;
 
     bool isOpen_;
- 
-    Buffer buff_;
-    int level_;
+
+    std::atomic<int> level_;
     bool isAsync_;
+    size_t ringCapacity_;  // 每个线程的环形缓冲区字节数
 
-    FILE* fp_;
-    std::unique_ptr<BlockDeque<std::string>> deque_;  // 阻塞队列
+    int fd_;
+    std::vector<std::shared_ptr<LogRing>> rings_;  // 各线程的环形缓冲区
+    std::mutex ringsMtx_;  // 保护rings_：只在线程登记和写日志线程取快照时加锁
+    EventCount wake_;  // 写日志线程没有日志可写时在此休眠
+    std::atomic<bool> isClose_;
     std::unique_ptr<std::thread> writeThread_;  // 写日志线程
-    std::mutex mtx_;  // 锁
+    std::mutex mtx_;  // 同步模式写入与切换日志文件的锁
 };
 
 #define LOG_BASE(level, format, ...) \
@@ -0,0 +1,63 @@
+#include "logring.h"
+#include <string.h>
+#include <assert.h>
+
+using namespace std;
+
+LogRing::LogRing(size_t capacity) : writePos_(0), readCache_(0), readPos_(0), closed_(false) {
+    size_t n = 1;
+    while(n < capacity || n < 2 * RecordSize_(MAX_LINE_LEN)) n <<= 1;
+    capacity_ = n;
+    mask_ = n - 1;
+    mem_.reset(new Header[n / sizeof(Header)]);
+    buf_ = reinterpret_cast<char*>(mem_.get());
+}
+
+bool LogRing::Push(int64_t ts, const char* line, size_t len) {
+    assert(len <= MAX_LINE_LEN);
+    size_t need = RecordSize_(len);
+    size_t pos = writePos_.load(memory_order_relaxed);
+    size_t room = capacity_ - (pos & mask_);  // 到缓冲区末尾的连续空间
+    size_t total = need <= room ? need : room + need;
+    if(capacity_ - (pos - readCache_) < total) {
+        readCache_ = readPos_.load(memory_order_acquire);
+        if(capacity_ - (pos - readCache_) < total) { return false; }
+    }
+    if(need > room) {
+        Header* pad = reinterpret_cast<Header*>(buf_ + (pos & mask_));
+        pad->len = PADDING;
+        pos += room;
+    }
+    Header* h = reinterpret_cast<Header*>(buf_ + (pos & mask_));
+    h->len = static_cast<uint32_t>(len);
+    h->ts = ts;
+    memcpy(h + 1, line, len);
+    writePos_.store(pos + need, memory_order_release);
+    return true;
+}
+
+void LogRing::Snapshot(Cursor* c) const {
+    c->pos = readPos_.load(memory_order_relaxed);
+    c->end = writePos_.load(memory_order_acquire);
+}
+
+void LogRing::SkipPadding_(Cursor* c) const {
+    if(c->pos != c->end && HeaderAt_(c->pos)->len == PADDING) {
+        c->pos += capacity_ - (c->pos & mask_);
+    }
+}
+
+const char* LogRing::Peek(Cursor* c, int64_t* ts, size_t* len) const {
+    SkipPadding_(c);
+    if(c->pos == c->end) { return nullptr; }
+    const Header* h = HeaderAt_(c->pos);
+    *ts = h->ts;
+    *len = h->len;
+    return reinterpret_cast<const char*>(h + 1);
+}
+
+void LogRing::Pop(Cursor* c) const {
+    SkipPadding_(c);
+    assert(c->pos != c->end);
+    c->pos += RecordSize_(HeaderAt_(c->pos)->len);
+}
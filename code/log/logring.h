@@ -0,0 +1,76 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+
+// 日志环形缓冲区：单生产者（所属线程）单消费者（写日志线程），无锁
+// 每条记录为记录头加日志行，按16字节对齐，不跨越缓冲区末尾：末尾的空间不足时写入填充记录，从开头继续
+// 读写位置只增不减，对容量取模得到偏移；消费者先按游标读取，写入文件后再释放空间，日志行直接从缓冲区writev
+class LogRing {
+public:
+    // 消费者的游标：从读位置到快照时的写位置
+    struct Cursor {
+        size_t pos;
+        size_t end;
+    };
+
+    // 容量向上取整为2的幂，至少能放下两条最长的记录
+    explicit LogRing(size_t capacity);
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // 生产者：追加一行，空间不足返回false
+    bool Push(int64_t ts, const char* line, size_t len);
+    // 生产者：所属线程退出，剩余的记录写完后由消费者移除
+    void Close() { closed_.store(true, std::memory_order_release); }
+
+    // 消费者：取得写位置的快照
+    void Snapshot(Cursor* c) const;
+    // 消费者：游标处的日志行，没有记录时返回nullptr
+    const char* Peek(Cursor* c, int64_t* ts, size_t* len) const;
+    // 消费者：游标移到下一条记录
+    void Pop(Cursor* c) const;
+    // 消费者：游标之前的记录已写入文件，释放空间
+    void Release(const Cursor& c) { readPos_.store(c.pos, std::memory_order_release); }
+
+    bool Empty() const {
+        return readPos_.load(std::memory_order_acquire) == writePos_.load(std::memory_order_acquire);
+    }
+    bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+
+    static const size_t MAX_LINE_LEN = 4096;  // 一行的最大长度
+
+private:
+    struct Header {
+        uint32_t len;  // 日志行长度，PADDING表示填充到缓冲区末尾
+        uint32_t reserved;
+        int64_t ts;  // 时间戳：微秒
+    };
+
+    static const uint32_t PADDING = UINT32_MAX;
+    static const size_t ALIGN = 16;
+
+    static size_t RecordSize_(size_t len) { return (sizeof(Header) + len + ALIGN - 1) & ~(ALIGN - 1); }
+    const Header* HeaderAt_(size_t pos) const { return reinterpret_cast<const Header*>(buf_ + (pos & mask_)); }
+    void SkipPadding_(Cursor* c) const;
+
+    std::unique_ptr<Header[]> mem_;  // 按记录头对齐分配
+    char* buf_;
+    size_t capacity_;
+    size_t mask_;
+
+    // 读写位置分属不同缓存行：生产者只写writePos_，消费者只写readPos_
+    char pad0_[64];
+    std::atomic<size_t> writePos_;
+    size_t readCache_;  // 生产者缓存的读位置：空间足够时不读取readPos_
+    char pad1_[64];
+    std::atomic<size_t> readPos_;
+    std::atomic<bool> closed_;
+    char pad2_[64];
+};
+
+#endif //LOG_RING_H
@@ -4,8 +4,15 @@
 int main() { 
     // 192.168.253.128:1316 虚拟机地址
     WebServer server(
-        1316, 3, 60000, false,             // 端口 ET模式 timeoutMs 优雅退出
+        1316, 3, 60000, false,             // 端口 ET模式 timeoutMs（保持连接空闲超时，0为不限时） 优雅退出
         3306, "root", "612612", "webserver", // Mysql配置
-        12, 6, true, 1, 1024);             // 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量
+        12, 6, true, 1, 1024,              // 连接池数量 线程池数量 日志开关 日志等级 每个线程的日志缓冲区行数（0为同步写入）
+        1, false,                          // Reactor数量：>1为多Reactor模式（每核一个事件循环，不使用线程池） io_uring后端
+        8 << 20, 0, 64 << 20,              // 请求体最大字节数：超过返回413，超过64KB的部分转存到临时文件
+                                           // 文件发送模式：0 mmap+writev 1 sendfile 2 sendfile+TCP_CORK
+                                           // 静态文件缓存字节数：0为不缓存
+        10,                                // 定时器精度（毫秒）：超时时间按该精度向上取整，到期的连接按批关闭
+        10000, 60000, 1024,                // 请求头超时 请求体超时（毫秒，0为不限时；各阶段都不限时时不启用定时器） 最低发送速率（字节/秒，按10秒的窗口统计）
+        1000);                             // 一个保持连接最多处理的请求数：0为不限制
     server.Start();
 }
@@ -0,0 +1,243 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <assert.h>
+#include <thread>
+
+// 事件计数器：基于futex的休眠与唤醒，没有等待者时通知只是一次原子加，不进入内核
+// 用法：key = PrepareWait(); 再次检查条件; 条件满足则CancelWait()，否则Wait(key)
+class EventCount {
+public:
+    EventCount() : seq_(0), waiters_(0) {}
+
+    // 登记等待并返回当前序号
+    uint32_t PrepareWait() {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        return seq_.load(std::memory_order_seq_cst);
+    }
+    // 条件已满足，取消等待
+    void CancelWait() {
+        waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+    // 序号仍为key时休眠，timeoutMs<0表示一直等待
+    void Wait(uint32_t key, int timeoutMs = -1) {
+        struct timespec ts;
+        struct timespec* pts = nullptr;
+        if(timeoutMs >= 0) {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+            pts = &ts;
+        }
+        if(seq_.load(std::memory_order_seq_cst) == key) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq_), FUTEX_WAIT_PRIVATE, key, pts, nullptr, 0);
+        }
+        waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+    // 是否有等待者：通知方在此之前需要一次seq_cst屏障，与PrepareWait之后的条件检查配对
+    bool HasWaiters() const { return waiters_.load(std::memory_order_seq_cst) > 0; }
+    // 唤醒一个等待者
+    void NotifyOne() { Notify_(1); }
+    // 唤醒全部等待者
+    void NotifyAll() { Notify_(INT_MAX); }
+
+private:
+    void Notify_(int n) {
+        seq_.fetch_add(1, std::memory_order_seq_cst);
+        if(waiters_.load(std::memory_order_seq_cst) > 0) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq_), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+        }
+    }
+
+    std::atomic<uint32_t> seq_;  // 每次通知加一，futex等待的地址
+    std::atomic<int> waiters_;  // 等待者数量
+};
+
+// 无锁有界多生产者多消费者队列（Vyukov环形队列）：
+// 每个槽位带一个序号，生产者和消费者各自用CAS推进位置，槽位序号表示该槽位可写还是可读
+template<class T>
+class MpmcQueue {
+public:
+    // 容量向上取整为2的幂
+    explicit MpmcQueue(size_t capacity) : enqueuePos_(0), dequeuePos_(0) {
+        assert(capacity > 0);
+        size_t n = 1;
+        while(n < capacity) n <<= 1;
+        mask_ = n - 1;
+        cells_.reset(new Cell[n]);
+        for(size_t i = 0; i < n; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // 入队，队列已满返回false
+    template<class U>
+    bool TryPush(U&& item) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(diff == 0) {
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if(diff < 0) {
+                return false;  // 槽位还未被消费：队列已满
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(item);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 出队，队列为空返回false
+    bool TryPop(T& item) {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if(diff == 0) {
+                if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if(diff < 0) {
+                return false;  // 槽位还未被写入：队列为空
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(cell->data);
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 元素个数：并发修改时为近似值，不加锁
+    size_t size() const {
+        size_t tail = enqueuePos_.load(std::memory_order_acquire);
+        size_t head = dequeuePos_.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    bool empty() const { return size() == 0; }
+
+    bool full() const { return size() >= capacity(); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;  // 槽位序号
+        T data;
+    };
+
+    static const size_t CACHELINE = 64;
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    char pad0_[CACHELINE];
+    std::atomic<size_t> enqueuePos_;  // 生产者位置
+    char pad1_[CACHELINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeuePos_;  // 消费者位置
+    char pad2_[CACHELINE - sizeof(std::atomic<size_t>)];
+};
+
+// 阻塞队列：在MpmcQueue外加futex休眠，供不想自行重试的生产者、消费者使用
+// 队列未满、未空时入队出队都不加锁也不进入内核
+template<class T>
+class MpmcBlockQueue {
+public:
+    explicit MpmcBlockQueue(size_t MaxCapacity = 1000) : queue_(MaxCapacity), isClose_(false) {}
+
+    ~MpmcBlockQueue() { Close(); }
+
+    bool empty() const { return queue_.empty(); }
+
+    bool full() const { return queue_.full(); }
+
+    size_t size() const { return queue_.size(); }
+
+    size_t capacity() const { return queue_.capacity(); }
+
+    // 关闭队列：唤醒所有等待的生产者和消费者
+    void Close() {
+        isClose_ = true;
+        notEmpty_.NotifyAll();
+        notFull_.NotifyAll();
+    }
+
+    // 唤醒一个消费者
+    void flush() { notEmpty_.NotifyOne(); }
+
+    // 丢弃队列中的全部元素
+    void clear() {
+        T item;
+        while(queue_.TryPop(item)) {}
+        notFull_.NotifyAll();
+    }
+
+    // 入队：队列已满时先自旋，仍满再等待；队列关闭时返回false
+    template<class U>
+    bool push_back(U&& item) {
+        for(int spin = 0; spin < SPIN_COUNT && queue_.full(); spin++) {
+            std::this_thread::yield();
+        }
+        while(!queue_.TryPush(std::forward<U>(item))) {
+            uint32_t key = notFull_.PrepareWait();
+            if(!queue_.full() || isClose_) {
+                notFull_.CancelWait();
+                if(isClose_) return false;
+                continue;
+            }
+            notFull_.Wait(key);
+        }
+        notEmpty_.NotifyOne();
+        return true;
+    }
+
+    // 出队：队列为空时等待，队列关闭且为空时返回false
+    bool pop(T& item) { return pop_(item, -1); }
+
+    // 出队：最多等待timeout秒
+    bool pop(T& item, int timeout) { return pop_(item, timeout * 1000); }
+
+private:
+    static const int SPIN_COUNT = 64;  // 休眠前的自旋次数
+
+    // 出队：队列为空时先自旋，仍为空再等待
+    bool pop_(T& item, int timeoutMs) {
+        for(int spin = 0; spin < SPIN_COUNT && queue_.empty() && !isClose_; spin++) {
+            std::this_thread::yield();
+        }
+        while(!queue_.TryPop(item)) {
+            uint32_t key = notEmpty_.PrepareWait();
+            if(!queue_.empty() || isClose_) {
+                notEmpty_.CancelWait();
+                if(isClose_ && queue_.empty()) return false;
+                continue;
+            }
+            notEmpty_.Wait(key, timeoutMs);
+            if(timeoutMs >= 0 && queue_.empty()) return false;
+        }
+        notFull_.NotifyOne();
+        return true;
+    }
+
+    MpmcQueue<T> queue_;
+    std::atomic<bool> isClose_;
+    EventCount notEmpty_;  // 消费者等待队列非空
+    EventCount notFull_;  // 生产者等待队列未满
+};
+
+#endif //MPMCQUEUE_H
@@ -0,0 +1,121 @@
+// 无锁队列基准：MpmcQueue与一把锁保护的有界std::deque对比，另测MpmcBlockQueue的阻塞出入队
+// P个生产者、P个消费者，元素总数平均分给各生产者，队列满或空时让出CPU重试（阻塞队列为休眠等待），统计每秒出入队的元素数
+// 用法：mpmcqueue_bench [元素总数] [队列容量]
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mpmcqueue.h"
+
+using namespace std;
+
+namespace {
+
+// 对照：加锁的有界队列
+class LockedQueue {
+public:
+    explicit LockedQueue(size_t capacity) : capacity_(capacity) {}
+
+    bool TryPush(size_t item) {
+        lock_guard<mutex> locker(mtx_);
+        if(deq_.size() >= capacity_) return false;
+        deq_.push_back(item);
+        return true;
+    }
+
+    bool TryPop(size_t& item) {
+        lock_guard<mutex> locker(mtx_);
+        if(deq_.empty()) return false;
+        item = deq_.front();
+        deq_.pop_front();
+        return true;
+    }
+
+private:
+    size_t capacity_;
+    deque<size_t> deq_;
+    mutex mtx_;
+};
+
+// 返回每秒元素数（百万），校验和不一致时返回负数
+template<class Q>
+double Run(Q& queue, int producers, size_t perProducer) {
+    atomic<size_t> consumed(0);
+    atomic<size_t> sum(0);
+    size_t total = producers * perProducer;
+    vector<thread> threads;
+    auto t0 = chrono::steady_clock::now();
+    for(int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, perProducer] {
+            for(size_t i = 1; i <= perProducer; i++) {
+                while(!queue.TryPush(i)) { this_thread::yield(); }
+            }
+        });
+        threads.emplace_back([&queue, &consumed, &sum, total] {
+            size_t item, local = 0;
+            while(consumed.load(memory_order_relaxed) < total) {
+                if(queue.TryPop(item)) {
+                    local += item;
+                    consumed.fetch_add(1, memory_order_relaxed);
+                } else {
+                    this_thread::yield();
+                }
+            }
+            sum.fetch_add(local);
+        });
+    }
+    for(thread& t : threads) { t.join(); }
+    double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    if(sum != producers * (perProducer * (perProducer + 1) / 2)) { return -1; }
+    return total / s / 1e6;
+}
+
+// 阻塞队列：生产者全部结束后关闭队列，消费者取空后退出
+double RunBlocking(MpmcBlockQueue<size_t>& queue, int producers, size_t perProducer) {
+    atomic<size_t> sum(0);
+    size_t total = producers * perProducer;
+    vector<thread> workers, consumers;
+    auto t0 = chrono::steady_clock::now();
+    for(int p = 0; p < producers; p++) {
+        workers.emplace_back([&queue, perProducer] {
+            for(size_t i = 1; i <= perProducer; i++) { queue.push_back(i); }
+        });
+        consumers.emplace_back([&queue, &sum] {
+            size_t item, local = 0;
+            while(queue.pop(item)) { local += item; }
+            sum.fetch_add(local);
+        });
+    }
+    for(thread& t : workers) { t.join(); }
+    queue.Close();
+    for(thread& t : consumers) { t.join(); }
+    double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    if(sum != producers * (perProducer * (perProducer + 1) / 2)) { return -1; }
+    return total / s / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t total = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t capacity = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1024;
+
+    printf("items %zu, capacity %zu, cpus %u\n", total, capacity,
+           thread::hardware_concurrency());
+    printf("producers  consumers   locked Mops/s   mpmc Mops/s   blocking Mops/s\n");
+    const int producers[] = {1, 4, 16};
+    for(int p : producers) {
+        size_t n = total / p;
+        LockedQueue locked(capacity);
+        MpmcQueue<size_t> mpmc(capacity);
+        MpmcBlockQueue<size_t> blocking(capacity);
+        double a = Run(locked, p, n);
+        double b = Run(mpmc, p, n);
+        double c = RunBlocking(blocking, p, n);
+        printf("%9d  %9d   %13.2f   %11.2f   %15.2f\n", p, p, a, b, c);
+    }
+    return 0;
+}
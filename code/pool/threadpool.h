@@ -1,37 +1,81 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
-#include <mutex>  
-#include <condition_variable>  
-#include <queue>
+#include <vector>
+#include <atomic>
 #include <thread> 
-#include <functional>
+#include <new>
+#include <type_traits>
+#include "mpmcqueue.h"
 
 using namespace std;
 
-// 线程池类
+// 定长任务：可调用对象直接存放在内部缓冲区，构造和拷贝都不分配内存
+// 只接受可平凡拷贝的小对象，例如只捕获指针和整数的lambda
+class Task {
+public:
+    static const size_t CAPACITY = 4 * sizeof(void*);  // 内部缓冲区大小
+
+    Task() : invoke_(nullptr) {}
+
+    template<class F, class T = typename decay<F>::type,
+             class = typename enable_if<!is_same<T, Task>::value>::type>
+    Task(F&& f) : invoke_(&Invoke_<T>) {
+        static_assert(sizeof(T) <= CAPACITY, "task too large for inline storage");
+        static_assert(is_trivially_copyable<T>::value, "task must be trivially copyable");
+        new (buf_) T(forward<F>(f));
+    }
+
+    // 执行任务
+    void operator()() { invoke_(buf_); }
+
+    explicit operator bool() const { return invoke_ != nullptr; }
+
+private:
+    template<class T>
+    static void Invoke_(void* p) { (*static_cast<T*>(p))(); }
+
+    alignas(void*) unsigned char buf_[CAPACITY];  // 可调用对象
+    void (*invoke_)(void*);  // 调用函数
+};
+
+// 线程池类：每个工作线程一个预分配的无锁环形任务队列，自己的队列为空时从其他线程的队列窃取任务，
+// 自旋一段时间仍没有任务才在futex上休眠；添加任务时只有存在休眠线程才进入内核唤醒。
+// 添加和取出任务都不加锁、不分配内存
 class ThreadPool {
 public:
-    // 构造函数
-    explicit ThreadPool(size_t threadCount = 8) : pool_(make_shared<Pool>()) {
+    // 构造函数：queueSize为每个工作线程队列的容量，向上取整为2的幂
+    explicit ThreadPool(size_t threadCount = 8, size_t queueSize = 1024)
+        : pool_(make_shared<Pool>(threadCount, queueSize)) {
             // 创建子线程，默认为8个，创建完成后处于休眠
             for(size_t i = 0; i < threadCount; i++) {
-                thread([pool = pool_] {
-                    unique_lock<mutex> locker(pool->mtx);  // 加锁
-                    // 判断任务是否为空
+                thread([pool = pool_, i] {
+                    Task task;
                     while(true) {
-                        if(!pool->tasks.empty()) {
-                            // 不为空
-                            auto task = move(pool->tasks.front());  // 取任务
-                            pool->tasks.pop();  // 移除任务
-                            locker.unlock();  // 解锁
+                        // 先取自己的队列，再窃取其他线程的队列
+                        if(pool->Take(i, task)) {
                             task();  // 执行任务
-                            locker.lock();  // 再次上锁
-                        } 
-                            // 判断线程池是否要关闭
-                        else if(pool->isClosed) break;  // 关闭直接退出循环
-                            // 为空
-                        else pool->cond.wait(locker);  // 处于等待状态
+                            continue;
+                        }
+                        // 自旋：任务通常很快就会到来，避免休眠和唤醒的开销
+                        bool got = false;
+                        for(int spin = 0; spin < SPIN_COUNT && !got; spin++) {
+                            this_thread::yield();
+                            got = pool->Take(i, task);
+                        }
+                        if(got) {
+                            task();
+                            continue;
+                        }
+                        // 判断线程池是否要关闭：关闭前已经取完全部任务
+                        if(pool->isClosed) break;
+                        // 休眠，直到有新任务或线程池关闭
+                        uint32_t key = pool->parker.PrepareWait();
+                        if(pool->queued > 0 || pool->isClosed) {
+                            pool->parker.CancelWait();
+                            continue;
+                        }
+                        pool->parker.Wait(key);
                     }
                 }).detach();  // 线程分离
             }
@@ -46,37 +90,65 @@ public:
     // 析构函数
     ~ThreadPool() {
         if(static_cast<bool>(pool_)) {
-            {
-                lock_guard<mutex> locker(pool_->mtx);  // 释放锁
-                pool_->isClosed = true;  // 关闭池子设置为true
-            }
-            pool_->cond.notify_all();
+            pool_->isClosed = true;  // 关闭池子设置为true
+            pool_->parker.NotifyAll();
         }
     }
 
-    // 添加任务
-    template<class F>
-    void AddTask(F&& task) {
-        // 添加任务到任务队列
-        {
-            lock_guard<mutex> locker(pool_->mtx);
-            // std::forward是一个完美转发点，可以将类型原封不动的转发走
-            pool_->tasks.emplace(forward<F>(task));  
+    // 添加任务：轮流放入各工作线程的队列；全部队列已满时让出CPU给工作线程后重试，
+    // 重试RETRY_COUNT次仍满才由调用线程直接执行，事件循环线程不会因短暂的突发而执行任务
+    // 任务数先加后入队，入队失败再减回：工作线程看到的任务数不会少于队列中的任务
+    void AddTask(Task task) {
+        size_t n = pool_->queues.size();
+        for(int retry = 0; retry <= RETRY_COUNT; retry++) {
+            if(retry > 0) { this_thread::yield(); }
+            size_t start = pool_->next++;
+            for(size_t k = 0; k < n; k++) {
+                pool_->queued++;
+                if(pool_->queues[(start + k) % n]->TryPush(task)) {
+                    // 有线程休眠才进入内核唤醒一个，忙碌的线程会通过窃取取走任务
+                    pool_->parker.NotifyOne();
+                    return;
+                }
+                pool_->queued--;
+            }
         }
-        // 唤醒一个线程
-        pool_->cond.notify_one();  
+        task();
     }
 
 private:
+    static const int SPIN_COUNT = 64;  // 休眠前的自旋次数
+    static const int RETRY_COUNT = 64;  // 全部队列已满时的重试次数
+
     // 线程池结构体
     struct Pool {
-        mutex mtx;  // 互斥锁
-        condition_variable cond;  // 条件变量
-        bool isClosed;  // 是否关闭线程池
-        queue<function<void()>> tasks;  // 任务队列
+        Pool(size_t n, size_t queueSize) : isClosed(false), queued(0), next(0) {
+            for(size_t i = 0; i < max<size_t>(n, 1); i++) {
+                queues.emplace_back(new MpmcQueue<Task>(queueSize));
+            }
+        }
+
+        // 取任务：先取自己的队列，再窃取其他队列
+        bool Take(size_t self, Task& task) {
+            if(queued == 0) return false;
+            size_t n = queues.size();
+            for(size_t k = 0; k < n; k++) {
+                if(queues[(self + k) % n]->TryPop(task)) {
+                    queued--;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        EventCount parker;  // 工作线程休眠与唤醒
+        atomic<bool> isClosed;  // 是否关闭线程池
+        atomic<size_t> queued;  // 所有队列中的任务总数
+        atomic<size_t> next;  // 轮流分发任务的下标
+        vector<unique_ptr<MpmcQueue<Task>>> queues;  // 每个工作线程一个无锁任务队列
     };
     // 线程池对象
     shared_ptr<Pool> pool_;  
 };
 
-#endif //THREADPOOL_H
\ No newline at end of file
+#endif //THREADPOOL_H
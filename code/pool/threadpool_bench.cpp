@@ -0,0 +1,144 @@
+// 线程池基准：当前的ThreadPool与原来的单队列线程池（一把锁 + 条件变量 + std::function）对比
+// 吞吐：一个线程（与事件循环相同）连续添加空任务，统计全部执行完的每秒任务数
+// 唤醒延迟：工作线程全部休眠后添加一个任务，统计从添加到开始执行的时间
+// 用法：threadpool_bench [工作线程数] [任务数] [唤醒次数]
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include "threadpool.h"
+
+namespace {
+
+// 原来的线程池：所有工作线程共用一个任务队列
+class LockedThreadPool {
+public:
+    explicit LockedThreadPool(size_t threadCount) : pool_(make_shared<Pool>()) {
+        for(size_t i = 0; i < threadCount; i++) {
+            thread([pool = pool_] {
+                unique_lock<mutex> locker(pool->mtx);
+                while(true) {
+                    if(!pool->tasks.empty()) {
+                        auto task = move(pool->tasks.front());
+                        pool->tasks.pop();
+                        locker.unlock();
+                        task();
+                        locker.lock();
+                    }
+                    else if(pool->isClosed) break;
+                    else pool->cond.wait(locker);
+                }
+            }).detach();
+        }
+    }
+
+    ~LockedThreadPool() {
+        {
+            lock_guard<mutex> locker(pool_->mtx);
+            pool_->isClosed = true;
+        }
+        pool_->cond.notify_all();
+    }
+
+    template<class F>
+    void AddTask(F&& task) {
+        {
+            lock_guard<mutex> locker(pool_->mtx);
+            pool_->tasks.emplace(forward<F>(task));
+        }
+        pool_->cond.notify_one();
+    }
+
+private:
+    struct Pool {
+        mutex mtx;
+        condition_variable cond;
+        bool isClosed = false;
+        queue<function<void()>> tasks;
+    };
+    shared_ptr<Pool> pool_;
+};
+
+typedef chrono::steady_clock Clock;
+
+int64_t NowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// 吞吐：每秒任务数；inlined为队列全满时由添加任务的线程直接执行的任务数
+template<class P>
+double Throughput(P& pool, int tasks, int* inlined) {
+    atomic<int> done(0), local(0);
+    atomic<int>* pdone = &done;
+    atomic<int>* plocal = &local;
+    thread::id self = this_thread::get_id();
+    const thread::id* pself = &self;
+    auto t0 = Clock::now();
+    for(int i = 0; i < tasks; i++) {
+        pool.AddTask([pdone, plocal, pself] {
+            if(this_thread::get_id() == *pself) { plocal->fetch_add(1, memory_order_relaxed); }
+            pdone->fetch_add(1, memory_order_relaxed);
+        });
+    }
+    while(done.load(memory_order_acquire) < tasks) {
+        this_thread::yield();
+    }
+    double s = chrono::duration<double>(Clock::now() - t0).count();
+    *inlined = local;
+    return tasks / s;
+}
+
+// 唤醒延迟：每次添加前等待工作线程休眠，返回排序后的延迟（纳秒）
+template<class P>
+vector<int64_t> WakeLatency(P& pool, int rounds) {
+    vector<int64_t> lat;
+    atomic<int64_t> start(0), started(0);
+    atomic<int64_t>* pstarted = &started;
+    for(int i = 0; i < rounds; i++) {
+        this_thread::sleep_for(chrono::milliseconds(2));  // 超过自旋时间，工作线程进入休眠
+        started = 0;
+        start = NowNs();
+        pool.AddTask([pstarted] { pstarted->store(NowNs(), memory_order_release); });
+        while(started.load(memory_order_acquire) == 0) {
+            this_thread::yield();
+        }
+        lat.push_back(started - start);
+    }
+    sort(lat.begin(), lat.end());
+    return lat;
+}
+
+template<class P>
+void Report(const char* name, P& pool, int tasks, int rounds) {
+    int inlined = 0;
+    Throughput(pool, tasks / 10, &inlined);  // 预热
+    double tps = Throughput(pool, tasks, &inlined);
+    vector<int64_t> lat = WakeLatency(pool, rounds);
+    printf("%-12s %8.2f Mtasks/s (%5.1f%% run by caller)   wake p50 %6.1f us  p99 %6.1f us\n", name, tps / 1e6,
+           100.0 * inlined / tasks, lat[lat.size() / 2] / 1e3, lat[lat.size() * 99 / 100] / 1e3);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 6;
+    int tasks = argc > 2 ? atoi(argv[2]) : 1000000;
+    int rounds = argc > 3 ? atoi(argv[3]) : 200;
+
+    printf("workers %d, tasks %d, wake rounds %d, cpus %u\n", threads, tasks, rounds,
+           thread::hardware_concurrency());
+    {
+        LockedThreadPool pool(threads);
+        Report("locked", pool, tasks, rounds);
+    }
+    {
+        ThreadPool pool(threads);
+        Report("stealing", pool, tasks, rounds);
+    }
+    return 0;
+}
@@ -11,19 +11,19 @@ Epoller::~Epoller() {
 }
 
 // 使用epoll_ctl处理文件描述符上的事件：添加
-bool Epoller::AddFd(int fd, uint32_t events) {
+bool Epoller::AddFd(int fd, uint32_t events, void* ptr) {
     if(fd < 0) return false;
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.ptr = ptr;
     ev.events = events;
     return 0 == epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
 }
 
 // 使用epoll_ctl处理文件描述符上的事件：修改
-bool Epoller::ModFd(int fd, uint32_t events) {
+bool Epoller::ModFd(int fd, uint32_t events, void* ptr) {
     if(fd < 0) return false;
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.ptr = ptr;
     ev.events = events;
     return 0 == epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
 }
@@ -40,10 +40,10 @@ int Epoller::Wait(int timeoutMs) {
     return epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeoutMs);
 }
 
-// 获取发生事件的文件描述符
-int Epoller::GetEventFd(size_t i) const {
+// 获取发生事件时附带的指针
+void* Epoller::GetEventPtr(size_t i) const {
     assert(i < events_.size() && i >= 0);
-    return events_[i].data.fd;
+    return events_[i].data.ptr;
 }
 
 // epoll事件表中对应的就绪事件
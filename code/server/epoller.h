@@ -7,25 +7,26 @@
 #include <assert.h> // close()
 #include <vector>
 #include <errno.h>
+#include "poller.h"
 
-class Epoller {
+class Epoller : public Poller {
 public:
     // 构造函数：最大事件为1024
     explicit Epoller(int maxEvent = 1024);
     // 析构函数
     ~Epoller();
     // 添加事件
-    bool AddFd(int fd, uint32_t events);
+    bool AddFd(int fd, uint32_t events, void* ptr) override;
     // 修改事件
-    bool ModFd(int fd, uint32_t events);
+    bool ModFd(int fd, uint32_t events, void* ptr) override;
     // 删除事件
-    bool DelFd(int fd);
+    bool DelFd(int fd) override;
     // epoll_wait
-    int Wait(int timeoutMs = -1);
-    // 获取发生事件的文件描述符
-    int GetEventFd(size_t i) const;
+    int Wait(int timeoutMs = -1) override;
+    // 获取发生事件时附带的指针
+    void* GetEventPtr(size_t i) const override;
     // 获取事件表中的就绪事件
-    uint32_t GetEvents(size_t i) const;
+    uint32_t GetEvents(size_t i) const override;
         
 private:
     int epollFd_;  // epoll_create()创建一个epoll对象 返回值就是epollFd，表示唯一的内核事件表
@@ -0,0 +1,20 @@
+#include "metrics.h"
+
+using namespace std;
+
+atomic<size_t> Metrics::counters_[Metrics::COUNTER_NUM];
+
+const char* const Metrics::NAMES[Metrics::COUNTER_NUM] = {
+    "header_timeout", "body_timeout", "idle_timeout", "send_timeout",
+    "idle_evicted", "busy_rejected",
+};
+
+void Metrics::Dump() {
+    char line[512];
+    int len = 0;
+    for(int i = 0; i < COUNTER_NUM && len < static_cast<int>(sizeof(line)); i++) {
+        len += snprintf(line + len, sizeof(line) - len, "%s%s=%zu", i ? ", " : "",
+                        NAMES[i], Get(static_cast<COUNTER>(i)));
+    }
+    LOG_INFO("Metrics: %s", line);
+}
@@ -0,0 +1,36 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <stddef.h>
+#include "../log/log.h"
+
+// 运行指标：进程级计数器，各线程以relaxed原子操作累加，服务器关闭时写入日志
+class Metrics {
+public:
+    enum COUNTER {
+        HEADER_TIMEOUT,  // 请求头未在时限内收完
+        BODY_TIMEOUT,  // 请求体未在时限内收完
+        IDLE_TIMEOUT,  // 保持连接空闲超时
+        SEND_TIMEOUT,  // 发送速率低于下限
+        IDLE_EVICTED,  // 文件描述符或内存不足时回收的空闲连接
+        BUSY_REJECTED,  // 没有可回收的空闲连接时拒绝的新连接
+        COUNTER_NUM,
+    };
+
+    static void Add(COUNTER c, size_t n = 1) {
+        counters_[c].fetch_add(n, std::memory_order_relaxed);
+    }
+    static size_t Get(COUNTER c) {
+        return counters_[c].load(std::memory_order_relaxed);
+    }
+    static const char* Name(COUNTER c) { return NAMES[c]; }
+    // 全部计数器写入一行日志
+    static void Dump();
+
+private:
+    static std::atomic<size_t> counters_[COUNTER_NUM];
+    static const char* const NAMES[COUNTER_NUM];
+};
+
+#endif //METRICS_H
@@ -0,0 +1,26 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// IO多路复用后端接口：事件语义与epoll保持一致（EPOLLIN/EPOLLOUT/EPOLLONESHOT等）
+// 注册时附带的ptr在事件就绪时原样返回，事件循环据此直接找到连接对象而无需查表
+class Poller {
+public:
+    virtual ~Poller() = default;
+    // 添加事件
+    virtual bool AddFd(int fd, uint32_t events, void* ptr) = 0;
+    // 修改事件
+    virtual bool ModFd(int fd, uint32_t events, void* ptr) = 0;
+    // 删除事件
+    virtual bool DelFd(int fd) = 0;
+    // 等待事件
+    virtual int Wait(int timeoutMs = -1) = 0;
+    // 获取发生事件时附带的指针
+    virtual void* GetEventPtr(size_t i) const = 0;
+    // 获取事件表中的就绪事件
+    virtual uint32_t GetEvents(size_t i) const = 0;
+};
+
+#endif //POLLER_H
@@ -0,0 +1,102 @@
+// IO多路复用后端基准：Epoller与Uringer在事件循环的使用方式下的开销
+// 每个连接是一对socketpair，服务端一侧按连接的方式注册EPOLLIN | EPOLLONESHOT | EPOLLET；
+// 每轮向随机的active个连接各写入1字节，事件循环Wait、读取并用ModFd重新注册，统计每个事件的耗时
+// 用法：poller_bench [连接数] [每轮活跃连接数] [轮数]
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include "epoller.h"
+#include "uringer.h"
+
+using namespace std;
+
+namespace {
+
+struct Conn {
+    int fd;  // 服务端一侧
+    int peer;  // 客户端一侧
+};
+
+// 返回每个事件的纳秒数，失败返回负数
+double Run(Poller* poller, vector<Conn>& conns, int active, int rounds) {
+    const uint32_t connEvent = EPOLLIN | EPOLLONESHOT | EPOLLET | EPOLLRDHUP;
+    for(Conn& c : conns) {
+        if(!poller->AddFd(c.fd, connEvent, &c)) { return -1; }
+    }
+    mt19937 rng(12345);
+    uniform_int_distribution<size_t> pick(0, conns.size() - 1);
+    char byte = 'x';
+    char buf[64];
+    long events = 0;
+    auto t0 = chrono::steady_clock::now();
+    for(int r = 0; r < rounds; r++) {
+        int pending = 0;
+        for(int i = 0; i < active; i++) {
+            if(write(conns[pick(rng)].peer, &byte, 1) == 1) { pending++; }
+        }
+        // 同一连接可能被选中多次，读完为止
+        while(pending > 0) {
+            int n = poller->Wait(1000);
+            if(n <= 0) { return -1; }
+            for(int i = 0; i < n; i++) {
+                Conn* c = static_cast<Conn*>(poller->GetEventPtr(i));
+                ssize_t len;
+                while((len = read(c->fd, buf, sizeof(buf))) > 0) { pending -= len; }
+                poller->ModFd(c->fd, connEvent, c);
+                events++;
+            }
+        }
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+    for(Conn& c : conns) { poller->DelFd(c.fd); }
+    poller->Wait(0);
+    return ns / events;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int connNum = argc > 1 ? atoi(argv[1]) : 1000;
+    int active = argc > 2 ? atoi(argv[2]) : 64;
+    int rounds = argc > 3 ? atoi(argv[3]) : 20000;
+
+    struct rlimit lim;
+    if(getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+    vector<Conn> conns(connNum);
+    for(Conn& c : conns) {
+        int sv[2];
+        if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0) {
+            perror("socketpair");
+            return 1;
+        }
+        c.fd = sv[0];
+        c.peer = sv[1];
+    }
+
+    printf("conns %d, active per round %d, rounds %d\n", connNum, active, rounds);
+    {
+        Epoller epoller;
+        printf("epoll   : %7.0f ns/event\n", Run(&epoller, conns, active, rounds));
+    }
+    {
+        Uringer uringer;
+        if(!uringer.IsValid()) {
+            printf("io_uring: unavailable\n");
+        } else {
+            printf("io_uring: %7.0f ns/event\n", Run(&uringer, conns, active, rounds));
+        }
+    }
+    for(Conn& c : conns) {
+        close(c.fd);
+        close(c.peer);
+    }
+    return 0;
+}
@@ -0,0 +1,678 @@
+#include "reactor.h"
+
+using namespace std;
+
+// 构造函数：初始化事件循环相关参数
+Reactor::Reactor(int port, uint32_t listenEvent, uint32_t connEvent, int timerTickMS,
+            bool openLinger, bool reusePort, bool useUring, ThreadPool* threadpool):
+            port_(port), openLinger_(openLinger), reusePort_(reusePort), backend_("epoll"), useTimer_(HttpConn::HasTimeout()),
+            isClose_(false), listenFd_(-1), timerFd_(-1), wakeFd_(-1), listenEvent_(listenEvent), connEvent_(connEvent),
+            threadpool_(threadpool), uring_(nullptr), users_(MAX_FD) {
+    lruPos_.assign(MAX_FD, lru_.end());
+    spareFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    timer_.reset(new TimingWheel(timerTickMS, [this](TimerNode* node) { OnTimeout_(node); }));
+    if(useUring) {
+        std::unique_ptr<Uringer> uringer(new Uringer());
+        if(uringer->IsValid()) {
+            // 多Reactor模式下收发都在本线程内，启用完成模式；内核不支持时仍按就绪事件处理
+            if(!threadpool_ && uringer->EnableCompletion(RECV_BUF_COUNT, RECV_BUF_SIZE)) {
+                uring_ = uringer.get();
+                io_.assign(MAX_FD, IoState());
+            }
+            backend_ = uring_ ? "io_uring (completion)" : "io_uring";
+            epoller_ = std::move(uringer);
+        } else {
+            LOG_WARN("io_uring unavailable, fall back to epoll!");
+        }
+    }
+    if(!epoller_) {
+        epoller_.reset(new Epoller());
+    }
+    // 定时器：timerfd按时间轮的下一次唤醒时间单次触发，epoll_wait总是阻塞等待
+    if(useTimer_) {
+        timerFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if(timerFd_ < 0 || !epoller_->AddFd(timerFd_, EPOLLIN, &timerFd_)) {
+            LOG_ERROR("Create timerfd error!");
+        }
+    }
+    if(threadpool_) {
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(wakeFd_ < 0 || !epoller_->AddFd(wakeFd_, EPOLLIN, &wakeFd_)) {
+            LOG_ERROR("Create eventfd error!");
+        }
+    }
+}
+
+// 析构函数：关闭监听Socket；先释放io_uring，内核中未完成的请求随之结束
+Reactor::~Reactor() {
+    epoller_.reset();
+    if(listenFd_ >= 0) { close(listenFd_); }
+    if(timerFd_ >= 0) { close(timerFd_); }
+    if(spareFd_ >= 0) { close(spareFd_); }
+    if(wakeFd_ >= 0) { close(wakeFd_); }
+    isClose_ = true;
+}
+
+// 事件循环
+void Reactor::Loop() {
+    // 服务器不关闭就一直循环运行
+    while(!isClose_) {
+        // 超时由timerfd唤醒，无事件时一直阻塞
+        int eventCnt = epoller_->Wait(-1);
+        CoarseClock::Update();  // 每轮更新一次时钟，本轮的定时器、响应头与日志共用
+        // 处理事件
+        for(int i = 0; i < eventCnt; i++) {
+            void* ptr = epoller_->GetEventPtr(i);  // 注册时附带的指针：监听Socket或HTTP连接
+            uint32_t events = epoller_->GetEvents(i);  // 事件类型
+            if(ptr == &listenFd_) {
+                DealListen_();  // 处理监听操作：添加客户端连接
+                continue;
+            }
+            if(ptr == &timerFd_) {
+                DealTimer_();  // 处理定时器：关闭超时连接
+                continue;
+            }
+            if(ptr == &wakeFd_) {
+                DealPosted_();  // 处理工作线程交回的读事件
+                continue;
+            }
+            HttpConn* client = static_cast<HttpConn*>(ptr);
+            assert(client);
+            uint32_t gen = client->GetGen();
+            if(!client->IsAlive(gen)) {
+                continue;  // 已关闭连接的残留事件
+            }
+            if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                CloseConn_(client, gen);  // 出现错误，关闭对应文件描述符的HTTP连接
+            }
+            else if(events & EPOLLIN) {
+                Touch_(client);
+                DealRead_(client, gen);  // 处理读操作
+            }
+            else if(events & EPOLLOUT) {
+                Touch_(client);
+                DealWrite_(client, gen);  // 处理写操作
+            } else {
+                LOG_ERROR("Unexpected event");
+            }
+        }
+        // 完成模式：处理accept、接收与发送的结果，本轮新提交的请求随下一次Wait一起提交
+        for(size_t i = 0; uring_ && i < uring_->CompletionCount(); i++) {
+            DealCompletion_(uring_->GetCompletion(i));
+        }
+        ArmTimer_();  // 本轮新增或提前的定时器
+    }
+}
+
+// 处理timerfd：读出到期次数，按当前时间推进时间轮，到期连接在一轮内全部处理
+void Reactor::DealTimer_() {
+    uint64_t expirations;
+    while(read(timerFd_, &expirations, sizeof(expirations)) > 0) {}
+    timer_->tick();
+}
+
+// 工作线程把推迟的读事件交回事件循环：保持连接上连续的请求经常落在这段间隔内，
+// 只在队列由空变为非空时写eventfd，事件循环一次取走全部
+void Reactor::PostRead_(HttpConn* client, uint32_t gen) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> locker(postMtx_);
+        wake = posted_.empty();
+        posted_.emplace_back(client, gen);
+    }
+    if(wake) {
+        uint64_t one = 1;
+        ssize_t ret = write(wakeFd_, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+// 处理交回的读事件：连接在此期间已关闭或被复用时丢弃
+void Reactor::DealPosted_() {
+    uint64_t cnt;
+    while(read(wakeFd_, &cnt, sizeof(cnt)) > 0) {}
+    std::vector<std::pair<HttpConn*, uint32_t>> posted;
+    {
+        std::lock_guard<std::mutex> locker(postMtx_);
+        posted.swap(posted_);
+    }
+    for(auto& item : posted) {
+        if(item.first->IsAlive(item.second)) {
+            DealRead_(item.first, item.second);
+        }
+    }
+}
+
+// 重新设置timerfd：时间轮的唤醒时间只在需要提前或上次唤醒已处理时变化，其余轮次不调用timerfd_settime
+// 粗粒度时钟可能落后于timerfd使用的精确时钟，到期时间加上时钟精度，保证唤醒时时间轮能看到到期
+void Reactor::ArmTimer_() {
+    int64_t expireMs;
+    if(timerFd_ < 0 || !timer_->UpdateAlarm(&expireMs)) { return; }
+    expireMs += CoarseClock::ResolutionMs();
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = expireMs / 1000;
+    spec.it_value.tv_nsec = (expireMs % 1000) * 1000000;
+    if(timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        LOG_ERROR("Set timerfd error!");
+    }
+}
+
+// 报错
+void Reactor::SendError_(int fd, const char*info) {
+    assert(fd > 0);
+    int ret = send(fd, info, strlen(info), 0);
+    if(ret < 0) {
+        LOG_WARN("send error to client[%d] error!", fd);
+    }
+    close(fd);
+}
+
+// 连接有活动：移到LRU的最近端，O(1)
+void Reactor::Touch_(HttpConn* client) {
+    std::list<HttpConn*>::iterator& pos = lruPos_[client->GetFd()];
+    if(pos == lru_.end()) {
+        pos = lru_.insert(lru_.end(), client);
+    } else {
+        lru_.splice(lru_.end(), lru_, pos);
+    }
+}
+
+// 回收空闲连接：从最久未活动的一端起，关闭处于空闲阶段、没有线程池任务的保持连接
+// 已关闭的连接顺便移出LRU，正在接收请求或发送响应的连接跳过
+int Reactor::EvictIdle_(int n) {
+    int evicted = 0;
+    int scanned = 0;
+    auto it = lru_.begin();
+    while(it != lru_.end() && evicted < n && scanned < MAX_EVICT_SCAN) {
+        HttpConn* client = *it;
+        uint32_t gen = client->GetGen();
+        scanned++;
+        if(!client->IsAlive(gen)) {
+            lruPos_[client->GetFd()] = lru_.end();
+            it = lru_.erase(it);
+            continue;
+        }
+        ++it;
+        if(client->HasPendingTask() || client->Phase() != HttpConn::IDLE_PHASE) {
+            continue;
+        }
+        LOG_INFO("Client[%d] evicted!", client->GetFd());
+        CloseConn_(client, gen);
+        Metrics::Add(Metrics::IDLE_EVICTED);
+        evicted++;
+    }
+    return evicted;
+}
+
+// 拒绝一个新连接：释放预留的文件描述符腾出位置，接受后立即关闭，再重新预留
+void Reactor::RejectOne_() {
+    if(spareFd_ < 0) { return; }
+    close(spareFd_);
+    int fd = accept(listenFd_, nullptr, nullptr);
+    if(fd >= 0) {
+        SendError_(fd, "Server busy!");
+        Metrics::Add(Metrics::BUSY_REJECTED);
+        LOG_WARN("Clients is full!");
+    }
+    spareFd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+// 关闭连接：先作废代数，保证工作线程与定时器同时关闭时只有一方真正关闭文件描述符
+void Reactor::CloseConn_(HttpConn* client, uint32_t gen) {
+    assert(client);
+    if(!client->Invalidate(gen)) { return; }
+    LOG_INFO("Client[%d] quit!", client->GetFd());
+    if(uring_) {
+        // 完成模式：撤销未完成的请求，全部结束后才关闭文件描述符
+        const IoState& io = io_[client->GetFd()];
+        // 按user_data撤销：内核按哈希查找，按文件描述符撤销要遍历全部请求；发送请求是两种中的一种，都撤销
+        if(io.recvArmed) {
+            uring_->Cancel(IoTag_(OP_RECV, client->GetFd()));
+        }
+        if(io.sending) {
+            uring_->Cancel(IoTag_(OP_SEND, client->GetFd()));
+            uring_->Cancel(IoTag_(OP_POLLOUT, client->GetFd()));
+        }
+        FinishClose_(client);
+        return;
+    }
+    epoller_->DelFd(client->GetFd());  //
+    client->Close();
+}
+
+// 定时器回调：按连接当前所处的阶段检查超时，未到期则按剩余时间重新计时，已到期则关闭连接并计数
+// 阶段在读写处理中切换，定时器不随之调整，到期时才按当时的阶段检查；只有空闲连接收到新请求时（超时可能提前）立即重新计时
+// 连接正被工作线程处理时其状态正在变化，稍后再检查
+// 连接关闭时（可能在工作线程中）不摘下节点，节点到期或文件描述符被复用时重新计时，已关闭的连接到期时直接返回
+void Reactor::OnTimeout_(TimerNode* node) {
+    HttpConn* client = static_cast<HttpConn*>(node->owner);
+    assert(client);
+    uint32_t gen = client->GetGen();
+    if(!client->IsAlive(gen)) { return; }
+    if(client->HasPendingTask()) {
+        timer_->add(node, RECHECK_MS);
+        return;
+    }
+    HttpConn::TIMEOUT_PHASE phase;
+    int remain = client->CheckTimeout(&phase);
+    if(remain > 0) {
+        timer_->add(node, remain);
+        return;
+    }
+    Metrics::COUNTER counter = Metrics::IDLE_TIMEOUT;
+    switch(phase) {
+    case HttpConn::HEADER_PHASE: counter = Metrics::HEADER_TIMEOUT; break;
+    case HttpConn::BODY_PHASE: counter = Metrics::BODY_TIMEOUT; break;
+    case HttpConn::IDLE_PHASE: counter = Metrics::IDLE_TIMEOUT; break;
+    case HttpConn::SEND_PHASE: counter = Metrics::SEND_TIMEOUT; break;
+    }
+    Metrics::Add(counter);
+    LOG_INFO("Client[%d] %s, total:%zu", client->GetFd(), Metrics::Name(counter), Metrics::Get(counter));
+    CloseConn_(client, gen);
+}
+
+// 添加客户端连接：
+void Reactor::AddClient_(int fd, sockaddr_in addr) {
+    assert(fd > 0 && fd < MAX_FD);
+    // 客户端连接初始化：槽位为空时创建连接对象，之后同一文件描述符复用该对象
+    std::unique_ptr<HttpConn>& slot = users_[fd];
+    if(!slot) {
+        slot.reset(new HttpConn());
+    }
+    HttpConn* client = slot.get();
+    client->init(fd, addr);
+    // 添加到计时器中：按请求头阶段的时限计时
+    if(useTimer_) {
+        HttpConn::TIMEOUT_PHASE phase;
+        timer_->add(client->GetTimerNode(), client->CheckTimeout(&phase));
+    }
+    Touch_(client);
+    LOG_INFO("Client[%d] in!", client->GetFd());
+    if(uring_) {
+        // 完成模式：accept返回的文件描述符已是非阻塞，提交multishot recv
+        io_[fd] = IoState();
+        ArmRecv_(client);
+        return;
+    }
+    // 添加到epoll事件表中
+    epoller_->AddFd(fd, EPOLLIN | connEvent_, client);
+    // epoll必须设置文件描述符为非阻塞
+    SetFdNonblock(fd);
+}
+
+// 处理监听Socket：添加客户端连接
+void Reactor::DealListen_() {
+    struct sockaddr_in addr;  // 保存链接的客户端信息
+    socklen_t len = sizeof(addr);
+    do {
+        // 接受连接
+        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
+        if(fd < 0) {
+            // 文件描述符或内存不足：先回收最久未活动的空闲连接再接受，没有可回收的连接时拒绝一个，
+            // 否则新连接一直留在队列中，监听Socket持续可读
+            if(errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                if(EvictIdle_(EVICT_BATCH) > 0) { continue; }
+                RejectOne_();
+            }
+            return;
+        }
+        // 添加连接
+        if(!AcceptClient_(fd, addr)) { return; }
+    } while(listenEvent_ & EPOLLET);
+}
+
+// 接受新连接：连接已满且没有可回收的空闲连接时拒绝
+bool Reactor::AcceptClient_(int fd, const sockaddr_in& addr) {
+    if(fd >= MAX_FD || (HttpConn::userCount >= MAX_FD && EvictIdle_(1) == 0)) {
+        SendError_(fd, "Server busy!");
+        Metrics::Add(Metrics::BUSY_REJECTED);
+        LOG_WARN("Clients is full!");
+        return false;
+    }
+    AddClient_(fd, addr);
+    return true;
+}
+
+// 处理读操作：交给工作线程，没有线程池时在本线程处理
+// 工作线程重新注册事件之后、任务计数减一之前收到的读事件：连接状态还在变化，不能切换阶段、重新计时，
+// 记下后由该任务结束时交回事件循环再处理（两边先写后读，只有一方能取到）
+void Reactor::DealRead_(HttpConn* client, uint32_t gen) {
+    assert(client);
+    if(client->HasPendingTask()) {
+        client->DeferRead(gen);
+        if(client->HasPendingTask() || !client->TakeDeferredRead()) { return; }
+    }
+    ExtentTime_(client);  // 更新超时时间
+    if(threadpool_) {
+        client->AddTask();
+        threadpool_->AddTask([this, client, gen] { OnTask_(client, gen, true); });
+    } else {
+        OnRead_(client, gen);
+    }
+}
+
+// 处理写操作：交给工作线程，没有线程池时在本线程处理
+// 发送阶段的超时按窗口内的发送量检查，写事件不调整定时器
+void Reactor::DealWrite_(HttpConn* client, uint32_t gen) {
+    assert(client);
+    if(threadpool_) {
+        client->AddTask();
+        threadpool_->AddTask([this, client, gen] { OnTask_(client, gen, false); });
+    } else {
+        OnWrite_(client, gen);
+    }
+}
+
+// 线程池任务入口：连接在排队期间已被关闭或复用时直接丢弃
+void Reactor::OnTask_(HttpConn* client, uint32_t gen, bool isRead) {
+    assert(client);
+    if(client->IsAlive(gen)) {
+        if(isRead) {
+            OnRead_(client, gen);
+        } else {
+            OnWrite_(client, gen);
+        }
+    }
+    client->TaskDone();
+    uint32_t deferred = client->TakeDeferredRead();
+    if(deferred) {
+        PostRead_(client, deferred);
+    }
+}
+
+// 有请求数据到达：空闲的保持连接开始接收新请求，按请求头超时重新计时
+// 其余情况不调整定时器，持续有数据到达也不能延长请求头、请求体的时限；调用时连接没有线程池任务
+void Reactor::ExtentTime_(HttpConn* client) {
+    assert(client);
+    if(useTimer_ && client->StartRequest()) {
+        HttpConn::TIMEOUT_PHASE phase;
+        timer_->adjust(client->GetTimerNode(), client->CheckTimeout(&phase));
+    }
+}
+
+// 工作线程读操作
+void Reactor::OnRead_(HttpConn* client, uint32_t gen) {
+    assert(client);
+    int ret = -1;
+    int readErrno = 0;
+    ret = client->read(&readErrno);  // 读取客户端的数据
+    if(ret <= 0 && readErrno != EAGAIN) {
+        CloseConn_(client, gen);
+        return;
+    }
+    // 处理，业务逻辑的处理
+    OnProcess(client);
+}
+
+// 工作线程处理操作：根据HTTP处理请求和响应来修改epoll中的对应事件状态
+void Reactor::OnProcess(HttpConn* client) {
+    if(client->process()) {
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, client);
+    } else {
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, client);
+    }
+}
+
+// 工作线程写操作
+void Reactor::OnWrite_(HttpConn* client, uint32_t gen) {
+    assert(client);
+    int ret = -1;
+    int writeErrno = 0;
+    ret = client->write(&writeErrno);  // 写客户端的数据
+    if(client->ToWriteBytes() == 0) {
+        /* 传输完成 */
+        if(client->IsKeepAlive()) {
+            OnProcess(client);
+            return;
+        }
+    }
+    else if(ret < 0) {
+        if(writeErrno == EAGAIN) {
+            /* 继续传输 */
+            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, client);
+            return;
+        }
+    }
+    CloseConn_(client, gen);
+}
+
+// 分发完成事件：user_data的高位为请求类型，低32位为文件描述符
+void Reactor::DealCompletion_(const Uringer::Completion& c) {
+    int op = static_cast<int>((c.data >> 32) & 0xff);
+    int fd = static_cast<int>(c.data & 0xffffffff);
+    switch(op) {
+    case OP_ACCEPT: DealAccept_(c.res, c.flags & IORING_CQE_F_MORE); break;
+    case OP_RECV: DealRecv_(fd, c.res, c.flags); break;
+    case OP_SEND:
+    case OP_POLLOUT: DealSent_(fd, static_cast<IO_OP>(op), c.res); break;
+    default: LOG_ERROR("Unexpected completion"); break;
+    }
+}
+
+// 新连接：文件描述符或内存不足时与DealListen_相同，先回收空闲连接，没有可回收的连接时拒绝一个
+// multishot accept出错或被内核终止后重新提交
+void Reactor::DealAccept_(int res, bool more) {
+    if(res >= 0) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        if(getpeername(res, (struct sockaddr *)&addr, &len) < 0) {
+            memset(&addr, 0, sizeof(addr));
+        }
+        AcceptClient_(res, addr);
+    } else if(res == -EMFILE || res == -ENFILE || res == -ENOBUFS || res == -ENOMEM) {
+        if(EvictIdle_(EVICT_BATCH) == 0) { RejectOne_(); }
+    } else if(res != -ECANCELED) {
+        LOG_WARN("Accept error:%d", -res);
+    }
+    if(!more && !isClose_ && !uring_->SubmitAccept(listenFd_, IoTag_(OP_ACCEPT, listenFd_))) {
+        LOG_ERROR("Submit accept error!");
+    }
+}
+
+// 提交multishot recv：失败时关闭连接
+void Reactor::ArmRecv_(HttpConn* client) {
+    int fd = client->GetFd();
+    io_[fd].recvArmed = uring_->SubmitRecv(fd, IoTag_(OP_RECV, fd));
+    if(!io_[fd].recvArmed) {
+        LOG_ERROR("Submit recv error!");
+        CloseConn_(client, client->GetGen());
+    }
+}
+
+// 收到数据：数据追加到读缓冲区后立即交还buffer；没有发送中的响应时处理请求
+// 发送未完成时继续接收，积压达到上限后撤销recv，发送完成时再重新提交
+// buffer不足（-ENOBUFS）或被撤销时recv结束，按需重新提交；对端关闭或其他错误时关闭连接
+void Reactor::DealRecv_(int fd, int res, uint32_t flags) {
+    HttpConn* client = users_[fd].get();
+    assert(client);
+    IoState& io = io_[fd];
+    if(!(flags & IORING_CQE_F_MORE)) {
+        io.recvArmed = false;
+    }
+    uint32_t gen = client->GetGen();
+    bool alive = client->IsAlive(gen);
+    if(res > 0 && alive) {
+        Touch_(client);
+        ExtentTime_(client);  // 更新超时时间
+        client->Received(uring_->RecvBuffer(flags), res);
+    }
+    if(flags & IORING_CQE_F_BUFFER) {
+        uring_->RecycleBuffer(flags);
+    }
+    if(!alive) {
+        FinishClose_(client);
+        return;
+    }
+    if(res == 0 || (res < 0 && res != -ENOBUFS && res != -ECANCELED)) {
+        CloseConn_(client, gen);
+        return;
+    }
+    if(res > 0 && !io.sending) {
+        Serve_(client, gen);
+        if(!client->IsAlive(gen)) { return; }
+    }
+    bool backlog = io.sending && client->ReadBytes() >= MAX_PENDING_READ;
+    if(io.recvArmed && backlog) {
+        uring_->Cancel(IoTag_(OP_RECV, fd));
+    } else if(!io.recvArmed && !backlog) {
+        ArmRecv_(client);
+    }
+}
+
+// 发送完成或可写：sendmsg发出一部分时继续发送剩余部分，响应全部发完时处理已收到的下一批请求
+void Reactor::DealSent_(int fd, IO_OP op, int res) {
+    HttpConn* client = users_[fd].get();
+    assert(client);
+    IoState& io = io_[fd];
+    io.sending = false;
+    uint32_t gen = client->GetGen();
+    if(!client->IsAlive(gen)) {
+        FinishClose_(client);
+        return;
+    }
+    if(op == OP_SEND && res == -EAGAIN) {
+        io.sending = uring_->SubmitPollOut(fd, IoTag_(OP_POLLOUT, fd));
+        if(!io.sending) { CloseConn_(client, gen); }
+        return;
+    }
+    if(res <= 0 || (op == OP_POLLOUT && (res & (EPOLLERR | EPOLLHUP)))) {
+        CloseConn_(client, gen);
+        return;
+    }
+    Touch_(client);
+    if(op == OP_SEND) {
+        client->Written(res);
+        if(client->ToWriteBytes() == 0 && !client->IsKeepAlive()) {
+            CloseConn_(client, gen);
+            return;
+        }
+    }
+    Serve_(client, gen);
+}
+
+// 处理请求并发送响应：内存块由sendmsg提交，提交后等待完成事件；文件区间没有对应的请求类型，
+// 仍由write用sendfile直接发送，发送缓冲区满时等待可写。响应全部发完后接着处理读缓冲区中的下一批请求
+void Reactor::Serve_(HttpConn* client, uint32_t gen) {
+    int fd = client->GetFd();
+    IoState& io = io_[fd];
+    while(client->ToWriteBytes() > 0 || client->process()) {
+        const struct msghdr* msg = client->SendMsg();
+        if(msg) {
+            io.sending = uring_->SubmitSendmsg(fd, msg, IoTag_(OP_SEND, fd));
+            if(!io.sending) { CloseConn_(client, gen); }
+            return;
+        }
+        int writeErrno = 0;
+        ssize_t ret = client->write(&writeErrno);
+        if(client->ToWriteBytes() > 0) {
+            if(ret < 0 && writeErrno == EAGAIN) {
+                io.sending = uring_->SubmitPollOut(fd, IoTag_(OP_POLLOUT, fd));
+                if(!io.sending) { CloseConn_(client, gen); }
+                return;
+            }
+            if(ret <= 0) {
+                CloseConn_(client, gen);
+                return;
+            }
+            continue;
+        }
+        if(!client->IsKeepAlive()) {
+            CloseConn_(client, gen);
+            return;
+        }
+    }
+    if(!io.recvArmed) {
+        ArmRecv_(client);
+    }
+}
+
+// 已作废的连接：recv与发送都已结束时才关闭文件描述符，之前槽位不会被新连接复用
+void Reactor::FinishClose_(HttpConn* client) {
+    const IoState& io = io_[client->GetFd()];
+    if(io.recvArmed || io.sending) { return; }
+    client->Close();
+}
+
+// 初始化Socket
+bool Reactor::InitSocket() {
+    int ret;
+    struct sockaddr_in addr;
+    if(port_ > 65535 || port_ < 1024) {
+        LOG_ERROR("Port:%d error!",  port_);
+        return false;
+    }
+    addr.sin_family = AF_INET;  // 地址族：与协议类型对应，TCP/IPv4协议族
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);  // 端口号：需要主机字节序向网络字节序转换
+    addr.sin_port = htons(port_);  // 端口号：需要主机字节序向网络字节序转换
+    struct linger optLinger = { 0 };
+    if(openLinger_) {
+        /* 优雅关闭: 直到所剩数据发送完毕或超时 */
+        optLinger.l_onoff = 1;
+        optLinger.l_linger = 1;
+    }
+    // 创建socket
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if(listenFd_ < 0) {
+        LOG_ERROR("Create socket error!", port_);
+        return false;
+    }
+
+    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    if(ret < 0) {
+        close(listenFd_);
+        LOG_ERROR("Init linger error!", port_);
+        return false;
+    }
+    int optval = 1;
+    /* 端口复用 */
+    /* 只有最后一个套接字会正常接收数据。 */
+    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    if(ret == -1) {
+        LOG_ERROR("set socket setsockopt error !");
+        close(listenFd_);
+        return false;
+    }
+    /* 多Reactor模式: 每个Reactor各自监听同一端口，内核按连接哈希分发 */
+    if(reusePort_) {
+        ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT, (const void*)&optval, sizeof(int));
+        if(ret == -1) {
+            LOG_ERROR("set socket SO_REUSEPORT error !");
+            close(listenFd_);
+            return false;
+        }
+    }
+    // 绑定地址
+    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
+    if(ret < 0) {
+        LOG_ERROR("Bind Port:%d error!", port_);
+        close(listenFd_);
+        return false;
+    }
+    // 监听
+    ret = listen(listenFd_, 6);
+    if(ret < 0) {
+        LOG_ERROR("Listen port:%d error!", port_);
+        close(listenFd_);
+        return false;
+    }
+    // 将待处理的客户连接添加到epoll事件表中；完成模式下提交multishot accept
+    if(uring_) {
+        ret = uring_->SubmitAccept(listenFd_, IoTag_(OP_ACCEPT, listenFd_));
+    } else {
+        ret = epoller_->AddFd(listenFd_,  listenEvent_ | EPOLLIN, &listenFd_);
+    }
+    if(ret == 0) {
+        LOG_ERROR("Add listen error!");
+        close(listenFd_);
+        return false;
+    }
+    SetFdNonblock(listenFd_);
+    LOG_INFO("Server port:%d", port_);
+    return true;
+}
+
+// 设置文件描述符非阻塞
+int Reactor::SetFdNonblock(int fd) {
+    assert(fd > 0);
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
+}
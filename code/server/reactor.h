@@ -0,0 +1,129 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <vector>
+#include <list>
+#include <atomic>
+#include <mutex>
+#include <fcntl.h>       // fcntl()
+#include <unistd.h>      // close()
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/timerfd.h> // timerfd_create()
+#include <sys/eventfd.h> // eventfd()
+
+#include "epoller.h"
+#include "uringer.h"
+#include "../log/log.h"
+#include "../timer/timingwheel.h"
+#include "../pool/threadpool.h"
+#include "../http/httpconn.h"
+#include "metrics.h"
+
+// 事件循环：每个Reactor独占一个epoll对象、定时器、连接表和监听Socket
+// 单Reactor模式下读写交给线程池；多Reactor模式下各自在本线程内处理，连接不跨线程
+// 多Reactor模式使用io_uring后端时为完成模式：accept、接收与发送提交给内核，按完成事件处理
+class Reactor {
+public:
+    // 构造函数：threadpool为空时在事件循环线程内直接处理读写；useUring选择io_uring后端；timerTickMS为定时器精度
+    Reactor(int port, uint32_t listenEvent, uint32_t connEvent, int timerTickMS,
+            bool openLinger, bool reusePort, bool useUring, ThreadPool* threadpool);
+    // 析构函数
+    ~Reactor();
+    // 初始化监听Socket
+    bool InitSocket();
+    // 事件循环
+    void Loop();
+    // 退出事件循环
+    void Stop() { isClose_ = true; }
+    // 实际使用的IO后端："epoll"、"io_uring"（就绪事件）或"io_uring (completion)"
+    const char* Backend() const { return backend_; }
+
+private:
+    void AddClient_(int fd, sockaddr_in addr);  // 添加客户端连接
+
+    // 以下函数的(client, gen)构成连接句柄：gen与连接当前代数不一致时说明连接已关闭或被复用
+    void DealListen_();  // 处理监听
+    void DealWrite_(HttpConn* client, uint32_t gen);  // 处理写
+    void DealRead_(HttpConn* client, uint32_t gen);  // 处理读
+
+    void SendError_(int fd, const char*info);  // 报错
+    void Touch_(HttpConn* client);  // 连接有活动：移到LRU的最近端
+    int EvictIdle_(int n);  // 回收最久未活动的至多n个空闲连接，返回回收的数量
+    void RejectOne_();  // 没有可回收的连接时，用预留的文件描述符接受并拒绝一个新连接
+    void ExtentTime_(HttpConn* client);
+    void CloseConn_(HttpConn* client, uint32_t gen);  // 关闭连接
+    void OnTimeout_(TimerNode* node);  // 定时器回调：超时关闭连接
+    void DealTimer_();  // 处理timerfd：一次处理全部到期的连接
+    void ArmTimer_();  // 时间轮的唤醒时间变化时重新设置timerfd
+    void PostRead_(HttpConn* client, uint32_t gen);  // 工作线程把推迟的读事件交回事件循环
+    void DealPosted_();  // 处理交回的读事件
+
+    // 完成模式：user_data由请求类型和文件描述符组成；连接的请求全部结束前不关闭文件描述符，
+    // 文件描述符不会被复用，完成事件总是属于该槽位当前的连接对象
+    enum IO_OP { OP_ACCEPT = 1, OP_RECV, OP_SEND, OP_POLLOUT };
+    struct IoState {
+        bool recvArmed;  // multishot recv是否仍有效
+        bool sending;  // 是否有未完成的sendmsg或等待可写
+    };
+    static uint64_t IoTag_(IO_OP op, int fd) {
+        return Uringer::COMPLETION_TAG | static_cast<uint64_t>(op) << 32 | static_cast<uint32_t>(fd);
+    }
+    void DealCompletion_(const Uringer::Completion& c);  // 分发一个完成事件
+    void DealAccept_(int res, bool more);  // 新连接
+    void DealRecv_(int fd, int res, uint32_t flags);  // 收到数据
+    void DealSent_(int fd, IO_OP op, int res);  // 发送完成或可写
+    void Serve_(HttpConn* client, uint32_t gen);  // 处理已收到的请求并发送响应
+    void ArmRecv_(HttpConn* client);  // 提交multishot recv
+    void FinishClose_(HttpConn* client);  // 已作废的连接没有未完成的请求时关闭文件描述符
+    bool AcceptClient_(int fd, const sockaddr_in& addr);  // 接受或拒绝新连接
+
+    void OnTask_(HttpConn* client, uint32_t gen, bool isRead);  // 线程池任务入口
+    void OnRead_(HttpConn* client, uint32_t gen);
+    void OnWrite_(HttpConn* client, uint32_t gen);
+    void OnProcess(HttpConn* client);
+
+    static const int MAX_FD = 65536;  // 最大的文件描述符的个数
+    static const int RECHECK_MS = 1000;  // 超时检查时连接正被工作线程处理：稍后再检查
+    static const int EVICT_BATCH = 16;  // 文件描述符不足时一次回收的空闲连接数
+    static const int MAX_EVICT_SCAN = 1024;  // 回收时最多检查的连接数
+    static const unsigned RECV_BUF_COUNT = 256;  // 完成模式的provided buffer数量：数据取走后立即交还，同一轮内循环使用
+    static const unsigned RECV_BUF_SIZE = 4096;  // 每个provided buffer的字节数
+    static const size_t MAX_PENDING_READ = 64 * 1024;  // 完成模式下发送未完成时读缓冲区积压的上限，超过时暂停接收
+
+    static int SetFdNonblock(int fd);  // 设置文件描述符非阻塞
+
+    int port_;  // 端口
+    bool openLinger_;  // 是否打开优雅关闭
+    bool reusePort_;  // 是否开启SO_REUSEPORT：多个Reactor绑定同一端口，由内核分发连接
+    const char* backend_;  // 实际使用的IO后端
+    bool useTimer_;  // 是否启用定时器：任一阶段限时（HttpConn::HasTimeout）时启用
+    std::atomic<bool> isClose_;  // 是否关闭
+    int listenFd_;  // 监听的文件描述符
+    int timerFd_;  // 定时器的timerfd：与连接一起由IO多路复用对象等待，附带指针为&timerFd_
+    int spareFd_;  // 预留的文件描述符：accept因EMFILE失败且没有空闲连接可回收时临时释放，用来拒绝新连接
+    int wakeFd_;  // 有交回的读事件时唤醒事件循环的eventfd，附带指针为&wakeFd_；只在使用线程池时创建
+    std::mutex postMtx_;  // 保护posted_
+    std::vector<std::pair<HttpConn*, uint32_t>> posted_;  // 工作线程交回的读事件：连接句柄
+
+    uint32_t listenEvent_;  // 监听的文件描述符事件
+    uint32_t connEvent_;  // 链接的文件描述符事件
+
+    ThreadPool* threadpool_;  // 线程池：由WebServer持有，多Reactor模式下为空
+    std::unique_ptr<TimingWheel> timer_;   // 定时器：分层时间轮，节点嵌在连接对象中
+    std::unique_ptr<Poller> epoller_;  // IO多路复用对象：Epoller或Uringer
+    Uringer* uring_;  // 完成模式时指向epoller_，否则为空
+    std::vector<IoState> io_;  // 完成模式下各文件描述符未完成的请求
+    // 连接表：以文件描述符为下标的预分配槽位，连接对象首次使用时创建并一直复用，地址稳定
+    // 事件注册时把HttpConn*放进epoll_event.data.ptr，事件分发无需查表
+    std::vector<std::unique_ptr<HttpConn>> users_;
+    // 连接的LRU：最久未活动的在前，只在事件循环线程中访问；文件描述符与连接对象一一对应，位置按文件描述符索引
+    // 连接关闭时（可能在工作线程中）不移出，回收时遇到再移除
+    std::list<HttpConn*> lru_;
+    std::vector<std::list<HttpConn*>::iterator> lruPos_;
+};
+
+#endif //REACTOR_H
@@ -0,0 +1,409 @@
+#include "uringer.h"
+
+// 构造函数：创建io_uring，失败时ringFd_为-1
+Uringer::Uringer(int maxEvent): ringFd_(-1), sqHead_(nullptr), sqTail_(nullptr), sqMask_(0),
+    sqEntries_(0), sqLocalTail_(0), sqes_(nullptr), cqHead_(nullptr), cqTail_(nullptr), cqMask_(0),
+    cqes_(nullptr), sqRing_(MAP_FAILED), sqRingSize_(0), cqRing_(MAP_FAILED), cqRingSize_(0),
+    sqesSize_(0), events_(maxEvent), bufRing_(nullptr), bufRingSize_(0), bufMask_(0), bufTail_(0), bufSize_(0) {
+    assert(events_.size() > 0);
+    if(!InitRing_(maxEvent)) {
+        UnmapRing_();
+        if(ringFd_ >= 0) { close(ringFd_); }
+        ringFd_ = -1;
+    }
+}
+
+// 析构函数：解除映射并关闭io_uring
+Uringer::~Uringer() {
+    UnmapRing_();
+    if(ringFd_ >= 0) { close(ringFd_); }
+    if(bufRing_) { munmap(bufRing_, bufRingSize_); }
+}
+
+// 创建io_uring并映射提交、完成队列
+bool Uringer::InitRing_(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ringFd_ = syscall(__NR_io_uring_setup, entries, &p);
+    if(ringFd_ < 0) { return false; }
+    // 等待超时需要EXT_ARG（Linux 5.11+），完成队列溢出不丢事件需要NODROP
+    if(!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) { return false; }
+
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    sqesSize_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqRing_ = mmap(0, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+    cqRing_ = mmap(0, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_CQ_RING);
+    void* sqes = mmap(0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ringFd_, IORING_OFF_SQES);
+    if(sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || sqes == MAP_FAILED) {
+        if(sqes != MAP_FAILED) { munmap(sqes, sqesSize_); }
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+    sqLocalTail_ = *sqTail_;
+    // 提交数组与sqes一一对应，之后直接按队尾下标填写sqes
+    unsigned* array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for(unsigned i = 0; i < sqEntries_; i++) { array[i] = i; }
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+}
+
+// 解除映射
+void Uringer::UnmapRing_() {
+    if(sqes_) { munmap(sqes_, sqesSize_); sqes_ = nullptr; }
+    if(sqRing_ != MAP_FAILED) { munmap(sqRing_, sqRingSize_); sqRing_ = MAP_FAILED; }
+    if(cqRing_ != MAP_FAILED) { munmap(cqRing_, cqRingSize_); cqRing_ = MAP_FAILED; }
+}
+
+// 添加事件
+bool Uringer::AddFd(int fd, uint32_t events, void* ptr) {
+    if(fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(!(events & EPOLLONESHOT)) {
+        multishot_[ptr] = std::make_pair(fd, events);
+    }
+    return PushPoll_(fd, events, ptr) && SubmitIfRemote_();
+}
+
+// 修改事件：连接都是EPOLLONESHOT，触发后内核中已没有该poll，重新提交即可
+bool Uringer::ModFd(int fd, uint32_t events, void* ptr) {
+    if(fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    return PushPoll_(fd, events, ptr) && SubmitIfRemote_();
+}
+
+// 删除事件：撤销尚未触发的poll，已触发的返回-ENOENT，在Reap_中忽略
+bool Uringer::DelFd(int fd) {
+    if(fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(static_cast<size_t>(fd) >= ptrs_.size()) return false;
+    void* ptr = ptrs_[fd];
+    multishot_.erase(ptr);
+    return PushSqe_(IORING_OP_POLL_REMOVE, -1, reinterpret_cast<uint64_t>(ptr), 0, 0, REMOVE_TAG)
+           && SubmitIfRemote_();
+}
+
+// 提交队列中的请求并等待至少一个完成事件
+int Uringer::Wait(int timeoutMs) {
+    completions_.clear();
+    unsigned toSubmit;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        loopId_ = std::this_thread::get_id();
+        toSubmit = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    }
+    // 完成队列中已有事件时只提交不等待
+    bool ready = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+    if(toSubmit > 0 || !ready) {
+        int ret = Enter_(toSubmit, ready ? 0 : 1, ready ? 0 : IORING_ENTER_GETEVENTS, timeoutMs);
+        if(ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+            return -1;
+        }
+    }
+    return Reap_();
+}
+
+// 获取发生事件时附带的指针
+void* Uringer::GetEventPtr(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].data.ptr;
+}
+
+// 获取就绪事件
+uint32_t Uringer::GetEvents(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].events;
+}
+
+// 写入POLL_ADD请求：不带EPOLLONESHOT的事件使用multishot poll，一次提交持续触发
+bool Uringer::PushPoll_(int fd, uint32_t events, void* ptr) {
+    uint32_t flags = (events & EPOLLONESHOT) ? 0 : IORING_POLL_ADD_MULTI;
+    uint32_t mask = events & ~(EPOLLONESHOT | EPOLLET);
+    if(static_cast<size_t>(fd) >= ptrs_.size()) {
+        ptrs_.resize(fd + 1, nullptr);
+    }
+    ptrs_[fd] = ptr;
+    return PushSqe_(IORING_OP_POLL_ADD, fd, 0, mask, flags, reinterpret_cast<uint64_t>(ptr));
+}
+
+// 写入一个提交请求：队列满时先提交一次腾出空间（调用方已加锁）
+bool Uringer::PushSqe_(uint8_t opcode, int fd, uint64_t addr, uint32_t pollEvents,
+                       uint32_t flags, uint64_t userData) {
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return false;
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = addr;
+    sqe->poll32_events = pollEvents;
+    sqe->len = flags;  // POLL_ADD的len字段为IORING_POLL_ADD_MULTI等标志
+    sqe->user_data = userData;
+    Commit_();
+    return true;
+}
+
+// 取一个提交项：队列满时先提交一次腾出空间（调用方已加锁）
+struct io_uring_sqe* Uringer::GetSqe_() {
+    if(ringFd_ < 0) return nullptr;
+    if(sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+        if(Enter_(sqEntries_, 0, 0, -1) < 0) { return nullptr; }
+    }
+    struct io_uring_sqe* sqe = &sqes_[sqLocalTail_ & sqMask_];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+// 填好的提交项对内核可见
+void Uringer::Commit_() {
+    sqLocalTail_++;
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+}
+
+// io_uring_enter：timeoutMs>=0时通过EXT_ARG设置等待超时
+int Uringer::Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs) {
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if(timeoutMs >= 0 && (flags & IORING_ENTER_GETEVENTS)) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    int ret;
+    do {
+        ret = syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete,
+                      flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    } while(ret < 0 && errno == EINTR && !(flags & IORING_ENTER_GETEVENTS));
+    return ret;
+}
+
+// 不在事件循环线程时立即提交（调用方已加锁）
+bool Uringer::SubmitIfRemote_() {
+    if(std::this_thread::get_id() == loopId_) { return true; }
+    unsigned toSubmit = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    return toSubmit == 0 || Enter_(toSubmit, 0, 0, -1) >= 0;
+}
+
+// 收集完成事件：跳过撤销请求及被撤销的poll，multishot poll被终止时重新提交
+int Uringer::Reap_() {
+    int n = 0;
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    rearm_.clear();
+    while(head != tail && static_cast<size_t>(n) < events_.size()) {
+        const struct io_uring_cqe* cqe = &cqes_[head & cqMask_];
+        head++;
+        if(cqe->user_data == REMOVE_TAG) {
+            continue;
+        }
+        if(cqe->user_data & COMPLETION_TAG) {
+            completions_.push_back({ cqe->user_data, cqe->res, cqe->flags });
+            continue;
+        }
+        void* ptr = reinterpret_cast<void*>(cqe->user_data);
+        if(!(cqe->flags & IORING_CQE_F_MORE) && cqe->res != -ECANCELED) {
+            rearm_.push_back(ptr);  // 单次poll也会进入这里，重新提交时只处理multishot_中的
+        }
+        if(cqe->res < 0) {
+            continue;
+        }
+        events_[n].data.ptr = ptr;
+        events_[n].events = static_cast<uint32_t>(cqe->res);
+        n++;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    if(!rearm_.empty()) {
+        std::lock_guard<std::mutex> locker(mtx_);
+        for(void* ptr: rearm_) {
+            auto it = multishot_.find(ptr);
+            if(it != multishot_.end()) { PushPoll_(it->second.first, it->second.second, ptr); }
+        }
+    }
+    return n;
+}
+
+#ifdef IORING_RECV_MULTISHOT
+// 启用完成模式：buffer环的地址必须按页对齐，条目数为2的幂
+bool Uringer::EnableCompletion(unsigned bufCount, unsigned bufSize) {
+    if(ringFd_ < 0 || bufCount == 0 || (bufCount & (bufCount - 1)) || bufCount > 32768) { return false; }
+    if(bufRing_) { return true; }
+    bufRingSize_ = bufCount * sizeof(struct io_uring_buf);
+    void* ring = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ring == MAP_FAILED) { return false; }
+    bufRing_ = static_cast<struct io_uring_buf_ring*>(ring);
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = bufCount;
+    reg.bgid = BUF_GROUP;
+    if(syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(bufRing_, bufRingSize_);
+        bufRing_ = nullptr;
+        return false;
+    }
+    bufMask_ = bufCount - 1;
+    bufSize_ = bufSize;
+    bufTail_ = 0;
+    bufs_.resize(static_cast<size_t>(bufCount) * bufSize);
+    for(unsigned i = 0; i < bufCount; i++) {
+        RecycleBuffer(i << IORING_CQE_BUFFER_SHIFT);
+    }
+    if(!ProbeRecv_()) {
+        ReleaseBuffers_();
+        return false;
+    }
+    return true;
+}
+
+// 注销并释放provided buffer
+void Uringer::ReleaseBuffers_() {
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.bgid = BUF_GROUP;
+    syscall(__NR_io_uring_register, ringFd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    munmap(bufRing_, bufRingSize_);
+    bufRing_ = nullptr;
+    std::vector<char>().swap(bufs_);
+}
+
+// 确认支持multishot recv：收到一个字节且请求仍然有效；之后关闭对端，等请求以res为0结束再关闭本端
+bool Uringer::ProbeRecv_() {
+    int sv[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0) { return false; }
+    bool ok = false;
+    Completion c;
+    if(SubmitRecv(sv[0], PROBE_TAG) && write(sv[1], "x", 1) == 1 && WaitOne_(&c)) {
+        ok = c.res == 1 && (c.flags & IORING_CQE_F_MORE) && (c.flags & IORING_CQE_F_BUFFER);
+        if(c.flags & IORING_CQE_F_BUFFER) { RecycleBuffer(c.flags); }
+        close(sv[1]);
+        sv[1] = -1;
+        while((c.flags & IORING_CQE_F_MORE) && WaitOne_(&c)) {
+            if(c.flags & IORING_CQE_F_BUFFER) { RecycleBuffer(c.flags); }
+        }
+        ok = ok && !(c.flags & IORING_CQE_F_MORE);
+    }
+    close(sv[0]);
+    if(sv[1] >= 0) { close(sv[1]); }
+    return ok;
+}
+
+// 同步等待一个完成事件：只在启用完成模式时使用，此时环中没有其他请求
+bool Uringer::WaitOne_(Completion* c) {
+    unsigned toSubmit = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if(__atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) == *cqHead_ || toSubmit > 0) {
+        Enter_(toSubmit, 1, IORING_ENTER_GETEVENTS, 1000);
+    }
+    unsigned head = *cqHead_;
+    if(__atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) == head) { return false; }
+    const struct io_uring_cqe* cqe = &cqes_[head & cqMask_];
+    *c = { cqe->user_data, cqe->res, cqe->flags };
+    __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// multishot accept
+bool Uringer::SubmitAccept(int fd, uint64_t data) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return false;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = data;
+    Commit_();
+    return SubmitIfRemote_();
+}
+
+// multishot recv：不指定buffer，由内核从BUF_GROUP中选取
+bool Uringer::SubmitRecv(int fd, uint64_t data) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return false;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = data;
+    Commit_();
+    return SubmitIfRemote_();
+}
+
+// sendmsg：MSG_NOSIGNAL，对端已关闭时返回-EPIPE
+bool Uringer::SubmitSendmsg(int fd, const struct msghdr* msg, uint64_t data) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return false;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = data;
+    Commit_();
+    return SubmitIfRemote_();
+}
+
+// 单次等待可写：res为就绪的事件
+bool Uringer::SubmitPollOut(int fd, uint64_t data) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return PushSqe_(IORING_OP_POLL_ADD, fd, 0, EPOLLOUT, 0, data) && SubmitIfRemote_();
+}
+
+// 按user_data撤销一个请求：找不到时（已完成）返回-ENOENT，在Reap_中忽略
+bool Uringer::Cancel(uint64_t data) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    struct io_uring_sqe* sqe = GetSqe_();
+    if(!sqe) return false;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = data;
+    sqe->user_data = REMOVE_TAG;
+    Commit_();
+    return SubmitIfRemote_();
+}
+
+// recv完成事件的buffer：flags的高16位为buffer编号
+const char* Uringer::RecvBuffer(uint32_t flags) const {
+    return &bufs_[static_cast<size_t>(flags >> IORING_CQE_BUFFER_SHIFT) * bufSize_];
+}
+
+// 把buffer放回环尾：第一个条目的resv与环的tail重叠，只填写addr、len和bid
+// 内核头文件中的bufs是C的柔性数组，按C++编译时前面多出一个空结构体，偏移不为0，直接按环首地址计算条目
+void Uringer::RecycleBuffer(uint32_t flags) {
+    uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+    struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(bufRing_) + (bufTail_ & bufMask_);
+    buf->addr = reinterpret_cast<uint64_t>(&bufs_[static_cast<size_t>(bid) * bufSize_]);
+    buf->len = bufSize_;
+    buf->bid = bid;
+    bufTail_++;
+    __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+}
+#else
+// 内核头文件不支持multishot recv：只提供就绪事件
+bool Uringer::EnableCompletion(unsigned, unsigned) { return false; }
+bool Uringer::SubmitAccept(int, uint64_t) { return false; }
+bool Uringer::SubmitRecv(int, uint64_t) { return false; }
+bool Uringer::SubmitSendmsg(int, const struct msghdr*, uint64_t) { return false; }
+bool Uringer::SubmitPollOut(int, uint64_t) { return false; }
+bool Uringer::Cancel(uint64_t) { return false; }
+const char* Uringer::RecvBuffer(uint32_t) const { return nullptr; }
+void Uringer::RecycleBuffer(uint32_t) {}
+bool Uringer::ProbeRecv_() { return false; }
+bool Uringer::WaitOne_(Completion*) { return false; }
+void Uringer::ReleaseBuffers_() {}
+#endif
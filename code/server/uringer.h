@@ -0,0 +1,133 @@
+#ifndef URINGER_H
+#define URINGER_H
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>   // EPOLLIN等事件标志
+#include <sys/mman.h>    // mmap, munmap
+#include <sys/syscall.h> // io_uring_setup, io_uring_enter, io_uring_register
+#include <sys/socket.h>  // socketpair, MSG_NOSIGNAL
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "poller.h"
+
+// io_uring后端：用IORING_OP_POLL_ADD实现与Epoller相同的就绪事件语义
+// 在事件循环线程内调用的Add/Mod/Del只写入提交队列，随下一次Wait一起提交（一次io_uring_enter）
+// 在其他线程（线程池）内调用时立即提交，保证工作线程重新注册的事件不会被延迟
+// 完成模式（EnableCompletion）：accept、接收与发送直接提交给内核，结果作为完成事件返回，
+// 连接收发数据不再各自调用accept/readv/writev，一轮事件循环的全部请求由一次io_uring_enter提交
+class Uringer : public Poller {
+public:
+    // 完成事件：完成模式下提交的请求的结果，data为提交时的user_data（带COMPLETION_TAG）
+    struct Completion {
+        uint64_t data;
+        int32_t res;
+        uint32_t flags;
+    };
+    static const uint64_t COMPLETION_TAG = 1ULL << 62;  // 完成模式请求的user_data标记，与就绪事件的指针区分
+
+
+    // 构造函数：提交队列长度与最大事件数相同
+    explicit Uringer(int maxEvent = 1024);
+    // 析构函数
+    ~Uringer();
+    // 内核是否支持：不支持时由调用方回退到Epoller
+    bool IsValid() const { return ringFd_ >= 0; }
+    // 添加事件：EPOLLONESHOT为单次poll，否则为multishot poll
+    bool AddFd(int fd, uint32_t events, void* ptr) override;
+    // 修改事件：单次poll触发后重新提交
+    bool ModFd(int fd, uint32_t events, void* ptr) override;
+    // 删除事件
+    bool DelFd(int fd) override;
+    // 提交队列中的请求并等待完成事件
+    int Wait(int timeoutMs = -1) override;
+    // 获取发生事件时附带的指针
+    void* GetEventPtr(size_t i) const override;
+    // 获取事件表中的就绪事件
+    uint32_t GetEvents(size_t i) const override;
+
+    // 启用完成模式：注册bufCount个bufSize字节的provided buffer，并确认内核支持multishot recv（Linux 6.0+）
+    // 以下函数只在事件循环线程内调用；不支持时返回false，调用方继续按就绪事件处理
+    bool EnableCompletion(unsigned bufCount, unsigned bufSize);
+    // multishot accept：每个新连接一个完成事件，res为非阻塞的新连接
+    bool SubmitAccept(int fd, uint64_t data);
+    // multishot recv：数据到达时由内核选一个provided buffer读入，每次一个完成事件，res为0表示对端关闭
+    bool SubmitRecv(int fd, uint64_t data);
+    // sendmsg：msg在完成前保持不变，不产生SIGPIPE
+    bool SubmitSendmsg(int fd, const struct msghdr* msg, uint64_t data);
+    // 单次等待可写
+    bool SubmitPollOut(int fd, uint64_t data);
+    // 撤销user_data为data的请求：被撤销的请求返回-ECANCELED
+    bool Cancel(uint64_t data);
+    // recv完成事件的数据所在的buffer
+    const char* RecvBuffer(uint32_t flags) const;
+    // 数据取走后把buffer交还内核
+    void RecycleBuffer(uint32_t flags);
+    // 本次Wait收集到的完成事件
+    size_t CompletionCount() const { return completions_.size(); }
+    const Completion& GetCompletion(size_t i) const { return completions_[i]; }
+
+private:
+    bool InitRing_(unsigned entries);  // 创建io_uring并映射提交、完成队列
+    void UnmapRing_();  // 解除映射
+    bool PushPoll_(int fd, uint32_t events, void* ptr);  // 写入POLL_ADD请求
+    bool PushSqe_(uint8_t opcode, int fd, uint64_t addr, uint32_t pollEvents,
+                  uint32_t flags, uint64_t userData);  // 写入一个提交请求
+    struct io_uring_sqe* GetSqe_();  // 取一个清零的提交项，填好后由Commit_对内核可见
+    void Commit_();
+    bool ProbeRecv_();  // 在socketpair上试收一个字节，确认支持multishot recv
+    bool WaitOne_(Completion* c);  // 启用完成模式时同步等待一个完成事件
+    void ReleaseBuffers_();  // 注销并释放provided buffer
+    int Enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, int timeoutMs);  // io_uring_enter
+    bool SubmitIfRemote_();  // 不在事件循环线程时立即提交
+    int Reap_();  // 收集完成事件到events_
+
+    static const uint64_t REMOVE_TAG = ~0ULL;  // POLL_REMOVE、撤销请求自身的user_data
+    static const uint64_t PROBE_TAG = COMPLETION_TAG;  // 探测multishot recv的user_data
+    static const uint16_t BUF_GROUP = 0;  // provided buffer的组号
+
+    int ringFd_;  // io_uring文件描述符
+
+    // 提交队列
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned sqLocalTail_;  // 已写入但未对内核可见的队尾
+    struct io_uring_sqe* sqes_;
+
+    // 完成队列
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    struct io_uring_cqe* cqes_;
+
+    void* sqRing_;
+    size_t sqRingSize_;
+    void* cqRing_;
+    size_t cqRingSize_;
+    size_t sqesSize_;
+
+    std::mutex mtx_;  // 保护提交队列：线程池中的工作线程也会修改事件
+    std::thread::id loopId_;  // 调用Wait的事件循环线程
+    std::vector<void*> ptrs_;  // 文件描述符对应的user_data，用于撤销poll
+    std::unordered_map<void*, std::pair<int, uint32_t>> multishot_;  // multishot poll：被内核终止时重新提交
+    std::vector<void*> rearm_;  // 本轮需要重新提交的poll
+    std::vector<struct epoll_event> events_;  // 就绪事件表，格式与epoll一致
+    std::vector<Completion> completions_;  // 完成事件表
+
+    // provided buffer：内核按环中的顺序取用，数据被取走后按buffer编号放回环尾
+    struct io_uring_buf_ring* bufRing_;
+    size_t bufRingSize_;
+    unsigned bufMask_;
+    uint16_t bufTail_;
+    unsigned bufSize_;
+    std::vector<char> bufs_;
+};
+
+#endif //URINGER_H
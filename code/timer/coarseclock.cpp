@@ -0,0 +1,107 @@
+#include "coarseclock.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+atomic<int64_t> CoarseClock::monoMs_(0);
+atomic<int64_t> CoarseClock::realUs_(0);
+
+namespace {
+
+const int PREFIX_LEN = 20;  // 日志时间戳中秒及以上部分的长度
+
+// 每个线程的格式化缓存：秒数不变时直接使用
+struct TimeCache {
+    time_t dateSec = -1;
+    string date;  // Date行
+    time_t localSec = -1;
+    struct tm local;  // 本地时间
+    char logPrefix[80];  // 日志时间戳中秒及以上的部分："2026-01-01 08:00:00."
+};
+
+TimeCache& Cache_() {
+    static thread_local TimeCache cache;
+    return cache;
+}
+
+} // namespace
+
+void CoarseClock::Update() {
+    struct timespec mono, real;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &mono);
+    clock_gettime(CLOCK_REALTIME_COARSE, &real);
+    int64_t ms = static_cast<int64_t>(mono.tv_sec) * 1000 + mono.tv_nsec / 1000000;
+    int64_t old = monoMs_.load(memory_order_relaxed);
+    while(old < ms && !monoMs_.compare_exchange_weak(old, ms, memory_order_relaxed)) {}
+    realUs_.store(static_cast<int64_t>(real.tv_sec) * 1000000 + real.tv_nsec / 1000, memory_order_relaxed);
+}
+
+void CoarseClock::EnsureInit_() {
+    if(realUs_.load(memory_order_relaxed) == 0) { Update(); }
+}
+
+int64_t CoarseClock::NowMs() {
+    EnsureInit_();
+    return monoMs_.load(memory_order_relaxed);
+}
+
+time_t CoarseClock::Seconds() {
+    EnsureInit_();
+    return static_cast<time_t>(realUs_.load(memory_order_relaxed) / 1000000);
+}
+
+int64_t CoarseClock::ReadRealUs() {
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME_COARSE, &real);
+    return static_cast<int64_t>(real.tv_sec) * 1000000 + real.tv_nsec / 1000;
+}
+
+const string& CoarseClock::DateLine() {
+    TimeCache& cache = Cache_();
+    time_t now = Seconds();
+    if(now != cache.dateSec) {
+        struct tm t;
+        char line[64];
+        gmtime_r(&now, &t);
+        size_t len = strftime(line, sizeof(line), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &t);
+        cache.date.assign(line, len);
+        cache.dateSec = now;
+    }
+    return cache.date;
+}
+
+int CoarseClock::ResolutionMs() {
+    static const int res = [] {
+        struct timespec ts;
+        if(clock_getres(CLOCK_MONOTONIC_COARSE, &ts) != 0) { return 10; }
+        return static_cast<int>((ts.tv_sec * 1000000000LL + ts.tv_nsec + 999999) / 1000000);
+    }();
+    return res;
+}
+
+const struct tm& CoarseClock::LocalTime(time_t now) {
+    TimeCache& cache = Cache_();
+    if(now != cache.localSec) {
+        localtime_r(&now, &cache.local);
+        const struct tm& t = cache.local;
+        snprintf(cache.logPrefix, sizeof(cache.logPrefix), "%04d-%02d-%02d %02d:%02d:%02d.",
+                 t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+        cache.localSec = now;
+    }
+    return cache.local;
+}
+
+int CoarseClock::LogTimestamp(char* buf, int64_t us) {
+    LocalTime(static_cast<time_t>(us / 1000000));  // 同一秒内只格式化一次秒及以上的部分
+    TimeCache& cache = Cache_();
+    int64_t frac = us % 1000000 / 1000;
+    memcpy(buf, cache.logPrefix, PREFIX_LEN);
+    for(int i = TIMESTAMP_LEN - 2; i >= PREFIX_LEN; i--) {
+        buf[i] = static_cast<char>('0' + frac % 10);
+        frac /= 10;
+    }
+    buf[TIMESTAMP_LEN - 1] = ' ';
+    buf[TIMESTAMP_LEN] = '\0';
+    return TIMESTAMP_LEN;
+}
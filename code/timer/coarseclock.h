@@ -0,0 +1,43 @@
+#ifndef COARSE_CLOCK_H
+#define COARSE_CLOCK_H
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+// 粗粒度时钟：事件循环每轮（epoll_wait返回后）调用Update读取一次CLOCK_MONOTONIC_COARSE与CLOCK_REALTIME_COARSE，
+// 其余线程只读取共享的时间值，不再各自调用时间函数；精度为一个时钟节拍（1~4毫秒），用于定时器与Date响应头
+// 服务器空闲时事件循环阻塞在epoll_wait，共享的时间值不再更新，不在事件循环中的线程（日志）直接读取时钟
+// Date行与日志时间戳按秒格式化，每个线程缓存一份，秒数变化时才重新格式化
+class CoarseClock {
+public:
+    // 更新时间：每次调用两次clock_gettime（vDSO，不陷入内核）
+    // 多Reactor的事件循环并发调用，单调时间只向前更新，较晚写入的旧值不会使其回退
+    static void Update();
+    // 单调时间：毫秒
+    static int64_t NowMs();
+    // 墙上时间：秒
+    static time_t Seconds();
+    // 墙上时间：微秒，直接读取CLOCK_REALTIME_COARSE（vDSO），不使用共享的时间值；日志按该值合并各线程的日志行
+    static int64_t ReadRealUs();
+    // Date响应头："Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+    static const std::string& DateLine();
+    // 日志时间戳："2026-01-01 08:00:00.000 "，us为ReadRealUs取得的时间，写入buf（至少TIMESTAMP_LEN + 1字节），返回长度
+    // 粗粒度时钟的精度为毫秒级，只输出到毫秒
+    static int LogTimestamp(char* buf, int64_t us);
+    // 本地时间：sec为墙上时间（秒），日志按日期切分文件时使用
+    static const struct tm& LocalTime(time_t sec);
+    // 时钟精度（毫秒，向上取整）：按精确时钟设置的定时在到期时，粗粒度时钟最多落后这么多
+    static int ResolutionMs();
+
+    static const int TIMESTAMP_LEN = 24;
+
+private:
+    static void EnsureInit_();  // 尚未调用过Update时先更新一次
+
+    static std::atomic<int64_t> monoMs_;  // 单调时间：毫秒
+    static std::atomic<int64_t> realUs_;  // 墙上时间：微秒
+};
+
+#endif //COARSE_CLOCK_H
@@ -0,0 +1,143 @@
+#include "timingwheel.h"
+
+TimingWheel::TimingWheel(int tickMs, const ExpireCallBack& cb):
+        tickMs_(tickMs > 0 ? tickMs : 1), alarm_(INT64_MAX), alarmDirty_(false), count_(0), cb_(cb) {
+    for(int level = 0; level < LEVELS; level++) {
+        for(int i = 0; i < SLOTS; i++) {
+            slots_[level][i].prev = slots_[level][i].next = &slots_[level][i];
+        }
+    }
+    current_ = NowTick_();
+}
+
+int64_t TimingWheel::NowTick_() const {
+    return CoarseClock::NowMs() / tickMs_;
+}
+
+// 从所在链表中摘下节点
+void TimingWheel::Unlink_(TimerNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+// 节点加到链表尾部
+void TimingWheel::PushBack_(TimerNode* head, TimerNode* node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+// 按剩余节拍选择层：第level层能放下剩余节拍小于256^(level+1)的节点，超出最上层范围的按最大值处理
+void TimingWheel::Link_(TimerNode* node) {
+    int64_t expires = node->expires < current_ ? current_ : node->expires;
+    int64_t delta = expires - current_;
+    int level = 0;
+    while(level < LEVELS - 1 && delta >= (int64_t(1) << ((level + 1) * SLOT_BITS))) {
+        level++;
+    }
+    if(delta >= (int64_t(1) << (LEVELS * SLOT_BITS))) {
+        expires = node->expires = current_ + (int64_t(1) << (LEVELS * SLOT_BITS)) - 1;
+    }
+    PushBack_(&slots_[level][(expires >> (level * SLOT_BITS)) & SLOT_MASK], node);
+}
+
+// 级联：上层当前的槽中的节点剩余时间都已不足一个上层槽，重新放入下层
+void TimingWheel::Cascade_(int level) {
+    TimerNode* head = &slots_[level][(current_ >> (level * SLOT_BITS)) & SLOT_MASK];
+    while(head->next != head) {
+        TimerNode* node = head->next;
+        Unlink_(node);
+        Link_(node);
+    }
+}
+
+// 添加定时器：到期节拍向上取整，保证不早于timeoutMs到期
+void TimingWheel::add(TimerNode* node, int timeoutMs) {
+    assert(node);
+    int64_t expires = (CoarseClock::NowMs() + timeoutMs + tickMs_ - 1) / tickMs_;
+    if(node->IsLinked()) {
+        if(node->expires == expires) { return; }  // 同一节拍内的多次调整
+        Unlink_(node);
+        count_--;
+    }
+    node->expires = expires;
+    Link_(node);
+    count_++;
+    if(node->expires < alarm_) { alarmDirty_ = true; }
+}
+
+void TimingWheel::cancel(TimerNode* node) {
+    assert(node);
+    if(node->IsLinked()) {
+        Unlink_(node);
+        count_--;
+    }
+}
+
+// 处理到期的定时器：逐个节拍推进，第0层转完一圈时先级联上层；
+// 当前槽先整体摘到临时链表再执行回调，回调中可以安全地添加、取消任意节点
+void TimingWheel::tick() {
+    int64_t target = NowTick_();
+    alarm_ = INT64_MAX;  // 每次处理后都重新计算唤醒时间
+    alarmDirty_ = true;
+    if(count_ == 0) {
+        if(current_ <= target) { current_ = target + 1; }  // 没有定时器时直接跳到当前时间
+        return;
+    }
+    while(current_ <= target) {
+        int index = current_ & SLOT_MASK;
+        if(index == 0) {
+            for(int level = 1; level < LEVELS; level++) {
+                Cascade_(level);
+                if(((current_ >> (level * SLOT_BITS)) & SLOT_MASK) != 0) { break; }
+            }
+        }
+        TimerNode* head = &slots_[0][index];
+        TimerNode expired;
+        expired.prev = expired.next = &expired;
+        if(head->next != head) {
+            expired.next = head->next;
+            expired.prev = head->prev;
+            expired.next->prev = expired.prev->next = &expired;
+            head->prev = head->next = head;
+        }
+        current_++;
+        while(expired.next != &expired) {
+            TimerNode* node = expired.next;
+            Unlink_(node);
+            count_--;
+            cb_(node);
+        }
+    }
+}
+
+void TimingWheel::clear() {
+    for(int level = 0; level < LEVELS; level++) {
+        for(int i = 0; i < SLOTS; i++) {
+            TimerNode* head = &slots_[level][i];
+            while(head->next != head) {
+                Unlink_(head->next);
+            }
+        }
+    }
+    count_ = 0;
+    alarm_ = INT64_MAX;
+    alarmDirty_ = false;
+}
+
+// 第0层中从当前节拍起的第一个非空槽，最多找到下一次级联为止
+bool TimingWheel::UpdateAlarm(int64_t* expireMs) {
+    assert(expireMs);
+    if(!alarmDirty_ || count_ == 0) { return false; }
+    alarmDirty_ = false;
+    int64_t next = current_;
+    while(slots_[0][next & SLOT_MASK].next == &slots_[0][next & SLOT_MASK]) {
+        next++;
+        if((next & SLOT_MASK) == 0) { break; }
+    }
+    alarm_ = next;
+    *expireMs = next * tickMs_;
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <functional>
+#include <assert.h>
+#include <stdint.h>
+#include "coarseclock.h"
+
+// 定时器节点：侵入式双向链表节点，嵌在连接对象中，由使用者持有，定时轮只负责链接
+struct TimerNode {
+    TimerNode* prev = nullptr;
+    TimerNode* next = nullptr;
+    int64_t expires = 0;  // 到期的节拍数
+    void* owner = nullptr;  // 节点所属的对象：到期回调中取回连接
+
+    bool IsLinked() const { return next != nullptr; }
+};
+
+typedef std::function<void(TimerNode*)> ExpireCallBack;
+
+// 分层时间轮：4层，每层256个槽，第0层一个槽为一个节拍，上层一个槽覆盖下一层的一整圈
+// 添加、调整、取消都只是链表操作，O(1)；上层的槽转到时把其中的节点按剩余时间重新放入下层（级联）
+// 非线程安全：只在事件循环线程中使用
+class TimingWheel {
+public:
+    // tickMs：节拍长度（毫秒），cb：到期回调
+    TimingWheel(int tickMs, const ExpireCallBack& cb);
+
+    // 析构时不访问节点：节点所在的连接对象可能已先于时间轮释放
+    ~TimingWheel() = default;
+
+    // 添加定时器：节点已在时间轮中时重新计时
+    void add(TimerNode* node, int timeoutMs);
+    // 调整定时器：与add相同，到期节拍不变时直接返回
+    void adjust(TimerNode* node, int timeoutMs) { add(node, timeoutMs); }
+    // 取消定时器
+    void cancel(TimerNode* node);
+    // 处理到期的定时器：依次执行回调，之后需要重新设置唤醒时间
+    void tick();
+    // 清空时间轮：摘下全部节点，不执行回调
+    void clear();
+    // 下一次唤醒时间：需要提前（新节点早于已设的唤醒时间）或上次唤醒已处理时返回true，expireMs为单调时间（毫秒）
+    // 唤醒时间为第0层中下一个非空槽，都为空时为下一次级联；没有定时器时返回false
+    bool UpdateAlarm(int64_t* expireMs);
+
+    size_t size() const { return count_; }
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int SLOT_MASK = SLOTS - 1;
+
+    int64_t NowTick_() const;  // 当前时间对应的节拍数
+    void Link_(TimerNode* node);  // 按到期节拍放入对应层的槽
+    void Cascade_(int level);  // 把level层当前的槽中的节点重新放入下层
+
+    static void Unlink_(TimerNode* node);
+    static void PushBack_(TimerNode* head, TimerNode* node);
+
+    int tickMs_;  // 节拍长度
+    int64_t current_;  // 下一个要处理的节拍
+    int64_t alarm_;  // 已设的唤醒节拍，INT64_MAX表示没有
+    bool alarmDirty_;  // 唤醒时间是否需要重新计算
+    size_t count_;  // 节点数量
+    ExpireCallBack cb_;  // 到期回调
+    TimerNode slots_[LEVELS][SLOTS];  // 各层的槽：循环链表的头节点
+};
+
+#endif //TIMING_WHEEL_H
@@ -0,0 +1,218 @@
+// 定时器基准：分层时间轮与原来的小根堆定时器（HeapTimer）对比
+// 添加：n个连接各添加一个定时器；调整：随机连接重新计时（每个请求一次）；到期：全部定时器到期后一次处理完
+// 添加的超时时间与服务器相同（60秒），每次调整再推迟一个节拍（时间轮每次都要重新链接，堆只需向下调整）；
+// 到期使用较短的超时时间（0~3秒，含时间轮的级联）；统计每个定时器（每次调整）的纳秒数
+// 用法：timingwheel_bench [连接数] [调整次数] [节拍毫秒数]
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "timingwheel.h"
+
+using namespace std;
+
+namespace heap {
+
+// 原来的小根堆定时器：按文件描述符索引节点，每个节点带一个回调
+// 保留原实现，只修正siftup_中i为0时下标越界的循环条件
+typedef std::function<void()> TimeoutCallBack;
+typedef std::chrono::high_resolution_clock Clock;
+typedef std::chrono::milliseconds MS;
+typedef Clock::time_point TimeStamp;
+
+struct TimerNode {
+    int id;
+    TimeStamp expires;
+    TimeoutCallBack cb;
+    bool operator<(const TimerNode& t) {
+        return expires < t.expires;
+    }
+};
+
+class HeapTimer {
+public:
+    HeapTimer() { heap_.reserve(64); }
+
+    void add(int id, int timeout, const TimeoutCallBack& cb) {
+        size_t i;
+        if(ref_.count(id) == 0) {
+            i = heap_.size();
+            ref_[id] = i;
+            heap_.push_back({id, Clock::now() + MS(timeout), cb});
+            siftup_(i);
+        }
+        else {
+            i = ref_[id];
+            heap_[i].expires = Clock::now() + MS(timeout);
+            heap_[i].cb = cb;
+            if(!siftdown_(i, heap_.size())) {
+                siftup_(i);
+            }
+        }
+    }
+
+    void adjust(int id, int timeout) {
+        heap_[ref_[id]].expires = Clock::now() + MS(timeout);
+        siftdown_(ref_[id], heap_.size());
+    }
+
+    void tick() {
+        while(!heap_.empty()) {
+            TimerNode node = heap_.front();
+            if(std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0) {
+                break;
+            }
+            node.cb();
+            del_(0);
+        }
+    }
+
+    size_t size() const { return heap_.size(); }
+
+private:
+    void del_(size_t index) {
+        size_t i = index;
+        size_t n = heap_.size() - 1;
+        if(i < n) {
+            SwapNode_(i, n);
+            if(!siftdown_(i, n)) {
+                siftup_(i);
+            }
+        }
+        ref_.erase(heap_.back().id);
+        heap_.pop_back();
+    }
+
+    void siftup_(size_t i) {
+        while(i > 0) {
+            size_t j = (i - 1) / 2;
+            if(heap_[j] < heap_[i]) { break; }
+            SwapNode_(i, j);
+            i = j;
+        }
+    }
+
+    bool siftdown_(size_t index, size_t n) {
+        size_t i = index;
+        size_t j = i * 2 + 1;
+        while(j < n) {
+            if(j + 1 < n && heap_[j + 1] < heap_[j]) j++;
+            if(heap_[i] < heap_[j]) break;
+            SwapNode_(i, j);
+            i = j;
+            j = i * 2 + 1;
+        }
+        return i > index;
+    }
+
+    void SwapNode_(size_t i, size_t j) {
+        std::swap(heap_[i], heap_[j]);
+        ref_[heap_[i].id] = i;
+        ref_[heap_[j].id] = j;
+    }
+
+    std::vector<TimerNode> heap_;
+    std::unordered_map<int, size_t> ref_;
+};
+
+} // namespace heap
+
+namespace {
+
+struct Conn {
+    TimerNode timer;
+    int fd;
+};
+
+typedef chrono::steady_clock Clock;
+
+double ElapsedNs(Clock::time_point t0) {
+    return chrono::duration<double, nano>(Clock::now() - t0).count();
+}
+
+struct Result {
+    double add, adjust, expire;  // 每个定时器（每次调整）的纳秒数
+};
+
+// 时间轮：节点嵌在连接中，回调只取回连接
+Result RunWheel(vector<Conn>& conns, const vector<int>& picks, const vector<int>& shortMs, int tickMs) {
+    Result r;
+    size_t expired = 0;
+    TimingWheel wheel(tickMs, [&expired](TimerNode* node) { expired += static_cast<Conn*>(node->owner)->fd >= 0; });
+    CoarseClock::Update();
+    auto t0 = Clock::now();
+    for(Conn& c : conns) { wheel.add(&c.timer, 60000); }
+    r.add = ElapsedNs(t0) / conns.size();
+
+    t0 = Clock::now();
+    for(size_t k = 0; k < picks.size(); k++) { wheel.adjust(&conns[picks[k]].timer, 60000 + k * tickMs); }
+    r.adjust = ElapsedNs(t0) / picks.size();
+
+    for(size_t i = 0; i < conns.size(); i++) { wheel.add(&conns[i].timer, shortMs[i]); }
+    this_thread::sleep_for(chrono::milliseconds(3000 + 2 * tickMs));
+    CoarseClock::Update();
+    t0 = Clock::now();
+    wheel.tick();
+    r.expire = ElapsedNs(t0) / conns.size();
+    if(expired != conns.size()) { fprintf(stderr, "wheel: %zu of %zu expired\n", expired, conns.size()); }
+    return r;
+}
+
+// 小根堆：按文件描述符索引，回调绑定连接（与原来的WebServer相同）
+Result RunHeap(vector<Conn>& conns, const vector<int>& picks, const vector<int>& shortMs, int tickMs) {
+    Result r;
+    size_t expired = 0;
+    heap::HeapTimer timer;
+    auto t0 = Clock::now();
+    for(Conn& c : conns) {
+        Conn* conn = &c;
+        timer.add(c.fd, 60000, [conn, &expired] { expired += conn->fd >= 0; });
+    }
+    r.add = ElapsedNs(t0) / conns.size();
+
+    t0 = Clock::now();
+    for(size_t k = 0; k < picks.size(); k++) { timer.adjust(conns[picks[k]].fd, 60000 + k * tickMs); }
+    r.adjust = ElapsedNs(t0) / picks.size();
+
+    for(size_t i = 0; i < conns.size(); i++) {
+        Conn* conn = &conns[i];
+        timer.add(conns[i].fd, shortMs[i], [conn, &expired] { expired += conn->fd >= 0; });
+    }
+    this_thread::sleep_for(chrono::milliseconds(3000 + 20));
+    t0 = Clock::now();
+    timer.tick();
+    r.expire = ElapsedNs(t0) / conns.size();
+    if(expired != conns.size()) { fprintf(stderr, "heap: %zu of %zu expired\n", expired, conns.size()); }
+    return r;
+}
+
+void Report(const char* name, const Result& r) {
+    printf("%-6s add %7.1f ns   adjust %7.1f ns   expire %7.1f ns\n", name, r.add, r.adjust, r.expire);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int connNum = argc > 1 ? atoi(argv[1]) : 10000;
+    int adjustNum = argc > 2 ? atoi(argv[2]) : 1000000;
+    int tickMs = argc > 3 ? atoi(argv[3]) : 10;
+
+    vector<Conn> conns(connNum);
+    for(int i = 0; i < connNum; i++) {
+        conns[i].fd = i + 3;
+        conns[i].timer.owner = &conns[i];
+    }
+    mt19937 rng(12345);
+    vector<int> picks(adjustNum);
+    for(int& i : picks) { i = uniform_int_distribution<int>(0, connNum - 1)(rng); }
+    vector<int> shortMs(connNum);
+    for(int& ms : shortMs) { ms = uniform_int_distribution<int>(0, 3000)(rng); }
+
+    printf("conns %d, adjusts %d, tick %d ms\n", connNum, adjustNum, tickMs);
+    Report("heap", RunHeap(conns, picks, shortMs, tickMs));
+    Report("wheel", RunWheel(conns, picks, shortMs, tickMs));
+    return 0;
+}